@@ -0,0 +1,109 @@
+// Times grid fills on one thread against ParallelAutofill on 2, 4, ... threads up to the
+// number of cores, on 15x15 and 21x21 grids. '#' is a block and '.' an open square.
+//
+//     ./autofill_bench [words.txt] [runs]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/autofill.h"
+#include "../src/parallel_autofill.h"
+
+struct Grid {
+    const char *name;
+    int size;
+    std::string cells;
+};
+
+// Blocks wherever (x + step * y + offset) % period == 0, so every run is period - 1 long
+// except at the edges.
+static Grid lattice(const char *name, int size, int step, int period, int offset) {
+    Grid grid{name, size, {}};
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            grid.cells += (x + step * y + offset) % period == 0 ? '#' : '.';
+        }
+    }
+    return grid;
+}
+
+static Grid rows(const char *name, std::initializer_list<const char *> lines) {
+    Grid grid{name, (int) lines.size(), {}};
+    for (const char *line: lines) {
+        grid.cells += line;
+    }
+    return grid;
+}
+
+static double median(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+template<typename F>
+static double time_fill(const Grid &grid, int runs, AutofillStatus *status, F &&fill) {
+    std::vector<double> times;
+    for (int run = 0; run < runs; ++run) {
+        std::vector<char> letters;
+        for (char c: grid.cells) {
+            letters.push_back(c == '#' ? '\0' : '.');
+        }
+        auto start = std::chrono::steady_clock::now();
+        *status = fill(letters.data());
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return median(times);
+}
+
+int main(int argc, char **argv) {
+    fs::Path words(argc > 1 ? argv[1] : "dictionary.txt");
+    int runs = argc > 2 ? atoi(argv[2]) : 3;
+
+    Dictionary dictionary;
+    if (!dictionary.open(words)) {
+        return 1;
+    }
+    dictionary.build_index();
+
+    const Grid grids[] = {
+            rows("15x15 open",
+                 {"...#....#....#.", "...#....#....#.", "...#....#......", "......#...#....", "##...#...#...##",
+                  "....#...#......", "...#...#...#...", "#....#...#....#", "...#...#...#...", "......#...#....",
+                  "##...#...#...##", "....#...#......", "......#....#...", ".#....#....#...", ".#....#....#..."}),
+            rows("15x15 no fill",
+                 {"....#....#.....", "....#....#.....", "....#....#.....", ".......#.......", "###...#...#....",
+                  ".....#...#.....", "...#.....#.....", "...#.......#...", ".....#.....#...", ".....#...#.....",
+                  "....#...#...###", ".......#.......", ".....#....#....", ".....#....#....", ".....#....#...."}),
+            lattice("21x21 lattice", 21, 2, 5, 0),
+            lattice("21x21 shifted", 21, 2, 5, 2),
+    };
+
+    int cores = (int) std::thread::hardware_concurrency();
+    printf("%d cores, %u words, median of %d runs\n", cores, dictionary.word_count, runs);
+    printf("%-15s %-8s %10s %9s  %s\n", "grid", "threads", "ms", "speedup", "result");
+
+    for (const Grid &grid: grids) {
+        Vector2i size(grid.size, grid.size);
+        AutofillStatus status;
+
+        Autofill serial;
+        double baseline = time_fill(grid, runs, &status, [&](char *letters) {
+            return serial.fill(dictionary, size, letters);
+        });
+        printf("%-15s %-8s %10.1f %9s  %s\n", grid.name, "serial", baseline, "1.00x", autofill_status_text(status));
+
+        for (int threads = 2; threads <= std::max(cores, 2); threads *= 2) {
+            ParallelAutofill parallel(threads);
+            double ms = time_fill(grid, runs, &status, [&](char *letters) {
+                return parallel.fill(dictionary, size, letters);
+            });
+            printf("%-15s %-8d %10.1f %8.2fx  %s\n", grid.name, threads, ms, baseline / ms, autofill_status_text(status));
+        }
+    }
+    return 0;
+}
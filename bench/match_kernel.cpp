@@ -0,0 +1,72 @@
+// Measures how many fixed-width words per second each masked compare kernel tests.
+//
+//     ./match_kernel_bench [words_per_bucket] [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../src/match_kernel.h"
+
+struct Case {
+    int len;
+    int literals;
+};
+
+int main(int argc, char **argv) {
+    size_t word_count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    const Case cases[] = {{5, 2}, {8, 3}, {12, 4}, {16, 2}, {24, 6}};
+    const MatchIsa isas[] = {MatchIsa::Scalar, MatchIsa::SSE2, MatchIsa::AVX2};
+
+    std::mt19937 rng(42);
+    printf("%-6s %-9s %-8s %14s %10s\n", "len", "literals", "isa", "words/s", "matches");
+
+    for (const Case &c: cases) {
+        int stride = match_stride(c.len);
+        std::vector<uint8_t> rows(word_count * stride, 0);
+        for (size_t i = 0; i < word_count; ++i) {
+            for (int p = 0; p < c.len; ++p) {
+                rows[i * stride + p] = (uint8_t) ('a' + rng() % 26);
+            }
+        }
+
+        uint8_t value[32] = {}, mask[32] = {};
+        for (int l = 0; l < c.literals; ++l) {
+            int p = (int) (rng() % c.len);
+            mask[p] = 0xFF;
+            value[p] = (uint8_t) ('a' + rng() % 4);
+        }
+
+        std::vector<uint64_t> out((word_count + 63) / 64);
+        std::vector<uint64_t> reference((word_count + 63) / 64);
+        match_kernel(MatchIsa::Scalar)(rows.data(), word_count, stride, value, mask, reference.data());
+
+        for (MatchIsa isa: isas) {
+            if (!match_isa_supported(isa)) {
+                printf("%-6d %-9d %-8s %14s %10s\n", c.len, c.literals, match_isa_name(isa), "unsupported", "-");
+                continue;
+            }
+
+            MatchKernel kernel = match_kernel(isa);
+            size_t matched = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                matched = kernel(rows.data(), word_count, stride, value, mask, out.data());
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (out != reference) {
+                fprintf(stderr, "%s kernel disagrees with the scalar kernel for len %d\n", match_isa_name(isa), c.len);
+                return 1;
+            }
+
+            double words_per_second = (double) word_count * iterations / seconds;
+            printf("%-6d %-9d %-8s %14.0f %10zu\n", c.len, c.literals, match_isa_name(isa), words_per_second, matched);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+// Times word searches, loading and saving puzzles, and laying out a frame of the grid, on
+// generated data, and writes the results as JSON so two releases can be diffed.
+//
+//     ./bench_suite [--quick] [--runs n] [--json report.json] [--words words.txt]
+//
+// --quick leaves out the 1M word dictionary and the 1000x1000 grid. --words adds a real
+// word list next to the generated ones.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../src/anagram_index.h"
+#include "../src/crossword.h"
+#include "../src/crossword_drawer.h"
+#include "../src/dictionary.h"
+#include "../src/heat_map.h"
+#include "../src/incremental_search.h"
+#include "../src/match_results.h"
+#include "../src/word_finder.h"
+#include "./synthetic.h"
+
+struct Timing {
+    double median_ms;
+    double min_ms;
+};
+
+struct Report {
+    std::string cases;
+    int runs = 5;
+
+    template<typename F>
+    Timing time(F &&run) const {
+        std::vector<double> times;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return {times[times.size() / 2], times[0]};
+    }
+
+    // `params` is the inside of a JSON object
+    void add(const char *group, const std::string &name, const std::string &params, Timing timing, size_t items) {
+        printf("%-8s %-34s %12.3f ms %12.3f ms %10zu\n", group, name.c_str(), timing.median_ms, timing.min_ms, items);
+        fflush(stdout);
+
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "    {\"group\": \"%s\", \"name\": \"%s\", \"params\": {%s}, \"median_ms\": %.4f, \"min_ms\": %.4f, \"items\": %zu}",
+                 group, name.c_str(), params.c_str(), timing.median_ms, timing.min_ms, items);
+        cases += (cases.empty() ? "" : ",\n") + std::string(line);
+    }
+
+    bool write(const char *path) const {
+        FILE *file = fopen(path, "w");
+        if (file == nullptr) return false;
+        fprintf(file, "{\n  \"runs\": %d,\n  \"cases\": [\n%s\n  ]\n}\n", runs, cases.c_str());
+        fclose(file);
+        return true;
+    }
+};
+
+struct SearchCase {
+    const char *name;
+    const char *pattern;
+};
+
+// Builds the pattern the word finder would, for the plain syntax plus [classes].
+static CompiledPattern compile(const char *text) {
+    CompiledPattern pattern;
+    int len = (int) strlen(text);
+    for (int i = 0; i < len; ++i) {
+        if (text[i] == '[') {
+            uint32_t mask = 0;
+            for (i += 1; text[i] != ']'; ++i) {
+                mask |= pattern_bit(text[i]);
+            }
+            pattern.push_mask(mask);
+        } else if (text[i] == '_' || text[i] == '*') {
+            pattern.push_any();
+            pattern.open_ended = text[i] == '*' && i == len - 1;
+        } else {
+            pattern.push_literal(text[i]);
+        }
+    }
+    return pattern;
+}
+
+// What the search worker does for one pattern, from a cold cache, plus ranking the first page.
+static void bench_search(Report &report, const char *dictionary_name, const char *words_path) {
+    Dictionary dictionary;
+    Timing index = report.time([&] {
+        Dictionary fresh;
+        fresh.open(fs::Path(words_path));
+        fresh.build_index();
+    });
+    if (!dictionary.open(fs::Path(words_path))) return;
+    dictionary.build_index();
+
+    std::string params = "\"dictionary\": \"" + std::string(dictionary_name) + "\", \"words\": " + std::to_string(dictionary.word_count);
+    report.add("search", std::string("index ") + dictionary_name, params, index, dictionary.word_count);
+
+    const SearchCase cases[] = {
+            {"literal prefix", "con*"},
+            {"fixed prefix", "re_____"},
+            {"sparse letters", "_a__e__"},
+            {"all wildcards", "_______"},
+            {"letter classes", "[aeiou]_[st]__"},
+            {"late literals", "____ing"},
+    };
+    for (const SearchCase &c: cases) {
+        CompiledPattern pattern = compile(c.pattern);
+        size_t matched = 0;
+        Timing timing = report.time([&] {
+            IncrementalSearch search;
+            Vec<RankedMatch> found;
+            search.sync(dictionary, pattern);
+            search.for_each_match(dictionary, [&](uint32_t id) {
+                found.push_back({dictionary.scores[id], id});
+                return true;
+            });
+            MatchResults results;
+            results.append(found.size() > 0 ? &found[0] : nullptr, found.size());
+            results.rank(WORD_FINDER_PAGE_SIZE);
+            matched = results.total();
+        });
+        report.add("search", std::string(c.name) + " " + c.pattern + " " + dictionary_name,
+                   params + ", \"pattern\": \"" + c.pattern + "\"", timing, matched);
+    }
+
+    AnagramIndex anagrams;
+    Timing build = report.time([&] {
+        AnagramIndex fresh;
+        fresh.build(dictionary);
+    });
+    anagrams.build(dictionary);
+    report.add("search", std::string("anagram index ") + dictionary_name, params, build, dictionary.word_count);
+
+    for (const char *rack: {"retains", "rtn__*"}) {
+        AnagramQuery query = AnagramQuery::parse(rack, (int) strlen(rack));
+        size_t matched = 0;
+        Timing timing = report.time([&] {
+            matched = 0;
+            anagrams.query(dictionary, query, [&](uint32_t) {
+                matched += 1;
+                return true;
+            });
+        });
+        report.add("search", std::string("anagram ") + rack + " " + dictionary_name, params + ", \"rack\": \"" + rack + "\"", timing, matched);
+    }
+}
+
+static void bench_files(Report &report, int size) {
+    std::string grid = std::to_string(size) + "x" + std::to_string(size);
+
+    Crossword crossword({size, size}, "Benchmark");
+    fill_synthetic_grid(crossword, (uint32_t) size);
+    size_t clues = crossword.across.size() + crossword.down.size();
+
+    for (ShareWordFormat format: {ShareWordFormat::Text, ShareWordFormat::Binary}) {
+        bool binary = format == ShareWordFormat::Binary;
+        std::string path = "bench_grid_" + std::to_string(size) + (binary ? SHAREWORD_BINARY_EXTENSION : ".shareword");
+        std::string params = "\"size\": " + std::to_string(size) + ", \"format\": \"" + (binary ? "binary" : "text") + "\"";
+        std::string name = grid + (binary ? " binary" : "");
+
+        Timing save = report.time([&] {
+            crossword.save_to(fs::Path(path.c_str()), format);
+        });
+        report.add("files", "save " + name, params, save, clues);
+
+        size_t loaded = 0;
+        Timing load = report.time([&] {
+            Crossword copy{fs::Path(path.c_str())};
+            loaded = copy.across.size() + copy.down.size();
+        });
+        report.add("files", "load " + name, params, load, loaded);
+        std::remove(path.c_str());
+    }
+}
+
+static void bench_layout(Report &report, int size, const Dictionary *dictionary) {
+    std::string params = "\"size\": " + std::to_string(size);
+    std::string grid = std::to_string(size) + "x" + std::to_string(size);
+
+    Crossword crossword({size, size}, "Benchmark");
+    fill_synthetic_grid(crossword, (uint32_t) size);
+
+    CrosswordDrawer drawer;
+    drawer.square_size = 32.0f;
+    GridFrame frame;
+    Timing plain = report.time([&] {
+        drawer.layout(crossword, nullptr, Vector2(0.0f), &frame);
+    });
+    report.add("layout", "frame " + grid, params, plain,
+               frame.blocks.size() + frame.letters.size() + frame.numbers.size());
+
+    // A letter typed each frame, so only its tile is laid out again
+    GridLayer layer;
+    drawer.refresh(crossword, Vector2(0.0f), &layer);
+    int typed = 0;
+    Timing cached = report.time([&] {
+        crossword.set({typed % size, typed / size % size}, typed % 2 == 0 ? 'A' : 'B');
+        typed += 1;
+        drawer.refresh(crossword, Vector2(0.0f), &layer);
+    });
+    report.add("layout", "cached frame after an edit " + grid, params, cached, (size_t) drawer.tiles_laid_out);
+
+    if (dictionary == nullptr) return;
+
+    HeatMap heat_map;
+    Timing update = report.time([&] {
+        HeatMap fresh;
+        fresh.update(*dictionary, crossword);
+    });
+    report.add("layout", "heat map " + grid, params, update, crossword.slots.slots.size());
+
+    heat_map.update(*dictionary, crossword);
+    Timing heat = report.time([&] {
+        drawer.layout(crossword, &heat_map, Vector2(0.0f), &frame);
+    });
+    report.add("layout", "frame with heat map " + grid, params, heat, frame.shades.size());
+}
+
+// A huge grid that is nearly all blocks, which the binary format and the layout skip a tile
+// at a time
+static void bench_sparse(Report &report, int size) {
+    std::string grid = std::to_string(size) + "x" + std::to_string(size) + " sparse";
+    std::string params = "\"size\": " + std::to_string(size) + ", \"sparse\": true";
+
+    Crossword crossword({size, size}, "Benchmark");
+    fill_sparse_synthetic_grid(crossword, (uint32_t) size, size * size / 2000 + 1);
+    size_t clues = crossword.across.size() + crossword.down.size();
+
+    std::string path = "bench_sparse_" + std::to_string(size) + SHAREWORD_BINARY_EXTENSION;
+    Timing save = report.time([&] {
+        crossword.save_to(fs::Path(path.c_str()));
+    });
+    report.add("files", "save " + grid + " binary", params, save, clues);
+
+    size_t loaded = 0;
+    Timing load = report.time([&] {
+        Crossword copy{fs::Path(path.c_str())};
+        loaded = copy.across.size() + copy.down.size();
+    });
+    report.add("files", "load " + grid + " binary", params, load, loaded);
+    std::remove(path.c_str());
+
+    CrosswordDrawer drawer;
+    drawer.square_size = 32.0f;
+    GridFrame frame;
+    Timing layout = report.time([&] {
+        drawer.layout(crossword, nullptr, Vector2(0.0f), &frame);
+    });
+    report.add("layout", "frame " + grid, params, layout,
+               frame.blocks.size() + frame.letters.size() + frame.numbers.size());
+}
+
+int main(int argc, char **argv) {
+    Report report;
+    bool quick = false;
+    const char *json = "bench_report.json";
+    const char *words = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            report.runs = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json = argv[++i];
+        } else if (strcmp(argv[i], "--words") == 0 && i + 1 < argc) {
+            words = argv[++i];
+        } else {
+            printf("usage: bench_suite [--quick] [--runs n] [--json report.json] [--words words.txt]\n");
+            return 1;
+        }
+    }
+
+    printf("%-8s %-34s %15s %15s %10s\n", "group", "case", "median", "min", "items");
+
+    std::vector<size_t> dictionary_sizes = {10000, 100000};
+    std::vector<int> grid_sizes = {15, 50, 200};
+    if (!quick) {
+        dictionary_sizes.push_back(1000000);
+        grid_sizes.push_back(1000);
+    }
+
+    for (size_t count: dictionary_sizes) {
+        std::string name = std::to_string(count / 1000) + "k";
+        std::string path = "bench_words_" + name + ".txt";
+        if (!write_synthetic_words(path.c_str(), count, (uint32_t) count)) {
+            printf("could not write %s\n", path.c_str());
+            return 1;
+        }
+        bench_search(report, name.c_str(), path.c_str());
+        std::remove(path.c_str());
+    }
+    if (words != nullptr) {
+        bench_search(report, "words", words);
+    }
+
+    for (int size: grid_sizes) {
+        bench_files(report, size);
+    }
+
+    // The heat map reads the smallest generated dictionary
+    const char *heat_words = "bench_words_heat.txt";
+    write_synthetic_words(heat_words, dictionary_sizes[0], (uint32_t) dictionary_sizes[0]);
+    Dictionary dictionary;
+    bool have_dictionary = dictionary.open(fs::Path(heat_words));
+    if (have_dictionary) {
+        dictionary.build_index();
+    }
+    for (int size: grid_sizes) {
+        bench_layout(report, size, have_dictionary ? &dictionary : nullptr);
+    }
+    std::remove(heat_words);
+
+    for (int size: grid_sizes) {
+        if (size >= 200) {
+            bench_sparse(report, size);
+        }
+    }
+
+    if (!report.write(json)) {
+        printf("could not write %s\n", json);
+        return 1;
+    }
+    printf("report written to %s\n", json);
+    return 0;
+}
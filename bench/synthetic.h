@@ -0,0 +1,121 @@
+#pragma once
+
+// Made-up word lists and grids for the benchmarks. Everything comes from a fixed seed, so
+// the same arguments always give the same data.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "../src/crossword.h"
+
+// Roughly how often each letter shows up in English text, per 1000
+static const int SYNTHETIC_LETTER_WEIGHTS[26] = {
+        82, 15, 28, 43, 127, 22, 20, 61, 70, 2, 8, 40, 24, 67, 75, 19, 1, 60, 63, 91, 28, 10, 24, 2, 20, 1,
+};
+
+inline char synthetic_letter(std::mt19937 &rng) {
+    static std::discrete_distribution<int> letters(SYNTHETIC_LETTER_WEIGHTS, SYNTHETIC_LETTER_WEIGHTS + 26);
+    return (char) ('a' + letters(rng));
+}
+
+// Writes `count` words of 2 to 15 letters, most of them 4 to 8 long, one per line.
+// Returns false if the file can't be written.
+inline bool write_synthetic_words(const char *path, size_t count, uint32_t seed) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) return false;
+
+    std::mt19937 rng(seed);
+    std::binomial_distribution<int> lengths(13, 0.35);
+    char word[16];
+    for (size_t i = 0; i < count; ++i) {
+        int len = 2 + lengths(rng);
+        for (int p = 0; p < len; ++p) {
+            word[p] = synthetic_letter(rng);
+        }
+        word[len] = '\n';
+        fwrite(word, 1, len + 1, file);
+    }
+    fclose(file);
+    return true;
+}
+
+// Builds the slots of a grid written straight into its letters, once, and puts a clue with
+// its standard number on every word.
+inline void number_synthetic_grid(Crossword &crossword) {
+    int w = crossword.size.x;
+    int h = crossword.size.y;
+    crossword.slots.build(crossword.size, crossword.letters);
+
+    crossword.across.clear();
+    crossword.down.clear();
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            int number = crossword.number_at({x, y});
+            if (number == 0) continue;
+
+            Answer answer;
+            answer.coords = {x, y};
+            answer.number = number;
+            snprintf(answer.hint, sizeof(answer.hint), "Clue for %d", number);
+            int across = crossword.slots.across_slot({x, y});
+            if (across != -1 && crossword.slots.slots[across].start == answer.coords) {
+                crossword.across.push_back(answer);
+            }
+            int down = crossword.slots.down_slot({x, y});
+            if (down != -1 && crossword.slots.slots[down].start == answer.coords) {
+                crossword.down.push_back(answer);
+            }
+        }
+    }
+    // Also written straight in, and already in order, so this only indexes them
+    crossword.sort_answers();
+}
+
+// Fills a square crossword with a symmetric pattern of blocks, about one square in
+// `block_every`, random letters in `filled` of every 100 open squares and '.' in the rest,
+// and a clue on every word with its standard number.
+inline void fill_synthetic_grid(Crossword &crossword, uint32_t seed, int block_every = 6, int filled = 50) {
+    std::mt19937 rng(seed);
+    int w = crossword.size.x;
+    int h = crossword.size.y;
+    for (int i = 0; i < w * h; ++i) {
+        crossword.letters[i] = '.';
+    }
+    for (int i = 0; i < (w * h + 1) / 2; ++i) {
+        if ((int) (rng() % block_every) == 0) {
+            crossword.letters[i] = '\0';
+            crossword.letters[w * h - 1 - i] = '\0';
+        }
+    }
+    for (int i = 0; i < w * h; ++i) {
+        if (crossword.letters[i] != '\0' && (int) (rng() % 100) < filled) {
+            crossword.letters[i] = (char) toupper(synthetic_letter(rng));
+        }
+    }
+    number_synthetic_grid(crossword);
+}
+
+// Blocks out a square crossword apart from `islands` open rectangles of up to 12x8 squares,
+// the way a huge puzzle that is mostly empty looks, with a clue on every word.
+inline void fill_sparse_synthetic_grid(Crossword &crossword, uint32_t seed, int islands) {
+    std::mt19937 rng(seed);
+    int w = crossword.size.x;
+    int h = crossword.size.y;
+    memset(crossword.letters, 0, (size_t) w * h);
+    for (int island = 0; island < islands; ++island) {
+        int x0 = (int) (rng() % w);
+        int y0 = (int) (rng() % h);
+        int x1 = std::min(w, x0 + 4 + (int) (rng() % 9));
+        int y1 = std::min(h, y0 + 3 + (int) (rng() % 6));
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                crossword.letters[y * w + x] = (char) toupper(synthetic_letter(rng));
+            }
+        }
+    }
+    number_synthetic_grid(crossword);
+}
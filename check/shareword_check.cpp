@@ -0,0 +1,358 @@
+// Checks the puzzle formats and the undo history against each other: text written and read
+// back, binary files read back as the same text, where the parser reports malformed
+// files, and undo and redo of every kind of edit, also once the oldest steps are dropped.
+// Prints each check that fails and exits with 1 if any did.
+//
+//     ./shareword_check
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/crossword.h"
+#include "../src/shareword_binary.h"
+#include "../src/shareword_parser.h"
+#include "../src/shareword_writer.h"
+
+static int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool passed, const char *condition, int line) {
+    if (!passed) {
+        printf("  failed at line %d: %s\n", line, condition);
+        failures += 1;
+    }
+}
+
+static std::string text_of(const Crossword &crossword) {
+    ShareWordBuffer buffer;
+    crossword.serialize(ShareWordFormat::Text, &buffer);
+    return std::string(buffer.bytes.begin(), buffer.bytes.end());
+}
+
+static bool write_file(const std::string &path, const std::string &data) {
+    return write_file_atomically(fs::Path(path.c_str()), data.data(), data.size());
+}
+
+static std::string read_file(const std::string &path) {
+    std::string data;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return data;
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.append(chunk, read);
+    }
+    fclose(file);
+    return data;
+}
+
+// Adds a clue, the way Enter does, for the word through `coord` unless it has one
+static void add_clue(Crossword &crossword, bool across, Vector2i coord, const char *hint) {
+    int slot = across ? crossword.slots.across_slot(coord) : crossword.slots.down_slot(coord);
+    if (slot == -1) return;
+    Vector2i start = crossword.slots.slots[slot].start;
+    if (crossword.find_answer(across, start) != -1) return;
+
+    Answer answer;
+    answer.coords = start;
+    answer.number = crossword.number_at(start);
+    strncpy(answer.hint, hint, SHAREWORD_MAX_HINT_LEN);
+    crossword.add_answer(across, answer);
+}
+
+// A `size` grid with a block wherever `block` says, `letter` everywhere else, and a clue on
+// every word
+template<typename Block, typename Letter>
+static Crossword make_puzzle(Vector2i size, const char *title, Block &&block, Letter &&letter) {
+    Crossword crossword(size, title);
+    for (int y = 0; y < size.y; ++y) {
+        for (int x = 0; x < size.x; ++x) {
+            crossword.set({x, y}, block(x, y) ? '\0' : letter(x, y));
+        }
+    }
+    crossword.end_step();
+
+    const char *hints[] = {"Plain", "With: colons, commas", "Quote's \"marks\"", "", "x"};
+    int hint = 0;
+    for (int y = 0; y < size.y; ++y) {
+        for (int x = 0; x < size.x; ++x) {
+            for (bool across: {true, false}) {
+                if (crossword.slots.starts_run(across, {x, y})) {
+                    add_clue(crossword, across, {x, y}, hints[hint++ % 5]);
+                }
+            }
+        }
+    }
+    crossword.end_step();
+    return crossword;
+}
+
+struct RoundTrip {
+    const char *name;
+    Crossword puzzle;
+    ShareWordGrid encoding;
+};
+
+static void check_round_trips(const std::string &dir) {
+    printf("text and binary round trips\n");
+
+    std::vector<RoundTrip> trips;
+    trips.push_back({"dense", make_puzzle({15, 15}, "Dense", [](int x, int y) { return (x * 7 + y * 3) % 11 == 0; }, [](int x, int y) { return (char) ('A' + (x + y * 15) % 26); }),
+                     ShareWordGrid::Packed});
+    trips.push_back({"raw", make_puzzle({9, 5}, "Raw squares", [](int x, int y) { return x == 4 && y == 2; }, [](int x, int y) { return "?.1 Q"[(x + y) % 5]; }),
+                     ShareWordGrid::Raw});
+    trips.push_back({"sparse", make_puzzle({100, 80}, "Sparse", [](int x, int y) { return !(y == 40 && x < 12) && !(x == 70 && y > 60); }, [](int x, int) { return (char) ('A' + x % 26); }),
+                     ShareWordGrid::Tiled});
+
+    // The longest title and hint there is room for
+    Crossword longest({3, 3}, "Twenty-nine characters, tops!");
+    longest.set({0, 0}, 'A');
+    longest.set({1, 0}, 'B');
+    longest.end_step();
+    std::string long_hint(SHAREWORD_MAX_HINT_LEN, 'h');
+    add_clue(longest, true, {0, 0}, long_hint.c_str());
+    longest.end_step();
+    trips.push_back({"longest", std::move(longest), ShareWordGrid::Packed});
+    CHECK(strlen(trips.back().puzzle.title) == SHAREWORD_MAX_TITLE_LEN);
+
+    for (RoundTrip &trip: trips) {
+        std::string text = text_of(trip.puzzle);
+        std::string text_path = dir + "/" + trip.name + ".shareword";
+        std::string binary_path = dir + "/" + trip.name + SHAREWORD_BINARY_EXTENSION;
+
+        CHECK(write_file(text_path, text));
+        ShareWordParse parse;
+        Crossword from_text(fs::Path(text_path.c_str()), &parse);
+        CHECK(parse.ok());
+        CHECK(text_of(from_text) == text);
+
+        trip.puzzle.save_to(fs::Path(binary_path.c_str()));
+        std::string binary = read_file(binary_path);
+        ShareWordBinary file;
+        CHECK(file.open(binary.data(), binary.size()).ok());
+        CHECK(file.header.grid_encoding == (uint32_t) trip.encoding);
+
+        Crossword from_binary(fs::Path(binary_path.c_str()), &parse);
+        CHECK(parse.ok());
+        CHECK(text_of(from_binary) == text);
+
+        // A puzzle read from either file writes the same binary file again
+        from_text.save_to(fs::Path(binary_path.c_str()));
+        CHECK(read_file(binary_path) == binary);
+    }
+
+    // What people write by hand: '\r\n', a line break after the grid and blank lines
+    std::string by_hand = "Hand\r\n2  2\r\nAB~C\r\nacross:\r\n\r\n1:0,0:Top\r\ndown:\r\n1:0,0:Left\r\n\r\n";
+    std::string written = "Hand\n2 2\nAB~Cacross:\n1:0,0:Top\ndown:\n1:0,0:Left\n";
+    CHECK(write_file(dir + "/hand.shareword", by_hand));
+    ShareWordParse parse;
+    Crossword hand(fs::Path((dir + "/hand.shareword").c_str()), &parse);
+    CHECK(parse.ok());
+    CHECK(text_of(hand) == written);
+}
+
+struct Malformed {
+    std::string data;
+    ShareWordError error;
+    int line;
+    int column;
+};
+
+struct IgnoreParts {
+    void title(const char *, int) {}
+    void grid(Vector2i, const char *) {}
+    void clue(bool, int, Vector2i, const char *, int) {}
+};
+
+static void check_errors() {
+    printf("error positions\n");
+
+    std::vector<Malformed> cases = {
+            {"", ShareWordError::Empty, 1, 1},
+            {std::string(SHAREWORD_MAX_TITLE_LEN + 1, 'T') + "\n1 1\nA\nacross:\n", ShareWordError::TitleTooLong, 1, SHAREWORD_MAX_TITLE_LEN + 1},
+            {"T\n3\n", ShareWordError::BadSize, 2, 2},
+            {"T\n3 x\n", ShareWordError::BadSize, 2, 3},
+            {"T\n0 3\n", ShareWordError::BadSize, 2, 4},
+            {"T\n65535 65535\n", ShareWordError::TooLarge, 2, 1},
+            {"T\n2 2\nAB", ShareWordError::GridTooShort, 3, 3},
+            {"T\n2 2\nABCD\nacros:\n", ShareWordError::MissingAcross, 4, 1},
+            {"T\n2 2\nABCDacross:\n1:0,0:ok\n1;0,0:bad\n", ShareWordError::BadClue, 5, 2},
+            {"T\n2 2\nABCD\nacross:\ndown:\n1:0,x:bad\n", ShareWordError::BadClue, 6, 5},
+            {"T\n1 1\nA\nacross:\n2147483648:0,0:too big\n", ShareWordError::BadClue, 5, 11},
+            {"T\r\n2 2\r\nABCD\r\nacross:\r\n1:0,0\r\n", ShareWordError::BadClue, 5, 6},
+            {"T\n1 1\nA\nacross:\n1:0,0:" + std::string(SHAREWORD_MAX_HINT_LEN + 1, 'h') + "\n", ShareWordError::HintTooLong, 5, 7 + SHAREWORD_MAX_HINT_LEN},
+    };
+    for (const Malformed &malformed: cases) {
+        IgnoreParts parts;
+        ShareWordParse parse = parse_shareword(malformed.data.data(), malformed.data.size(), parts);
+        if (parse.error != malformed.error || parse.line != malformed.line || parse.column != malformed.column) {
+            printf("  \"%s\": got %s at %d:%d\n", malformed.data.c_str(), shareword_error_text(parse.error), parse.line, parse.column);
+        }
+        CHECK(parse.error == malformed.error && parse.line == malformed.line && parse.column == malformed.column);
+    }
+
+    // Binary files give the byte offset of what is wrong on line 0
+    Crossword puzzle({4, 4}, "Binary");
+    puzzle.set({1, 1}, 'A');
+    ShareWordBuffer buffer;
+    puzzle.serialize(ShareWordFormat::Binary, &buffer);
+    std::string binary(buffer.bytes.begin(), buffer.bytes.end());
+
+    ShareWordBinary file;
+    ShareWordParse parse = file.open(binary.data(), 40);
+    CHECK(parse.error == ShareWordError::Truncated && parse.line == 0 && parse.column == 40);
+
+    std::string newer = binary;
+    newer[offsetof(ShareWordHeader, version)] += 1;
+    parse = file.open(newer.data(), newer.size());
+    CHECK(parse.error == ShareWordError::UnsupportedVersion && parse.column == (int) offsetof(ShareWordHeader, version));
+
+    std::string huge = binary;
+    int32_t side = SHAREWORD_BINARY_MAX_SIDE;
+    memcpy(&huge[offsetof(ShareWordHeader, width)], &side, sizeof(side));
+    memcpy(&huge[offsetof(ShareWordHeader, height)], &side, sizeof(side));
+    parse = file.open(huge.data(), huge.size());
+    CHECK(parse.error == ShareWordError::TooLarge && parse.column == (int) offsetof(ShareWordHeader, width));
+}
+
+// Makes one step of random edits of every kind the history records. It always changes a
+// letter, so that every step is one undo.
+static void random_step(Crossword &crossword, std::mt19937 &rng, bool letters_only) {
+    Vector2i changed{(int) (rng() % crossword.size.x), (int) (rng() % crossword.size.y)};
+    auto letter = (char) ('A' + rng() % 25);
+    crossword.set(changed, crossword.at(changed) == letter ? (char) (letter + 1) : letter);
+
+    int edits = (int) (rng() % 3);
+    for (int e = 0; e < edits; ++e) {
+        Vector2i coord{(int) (rng() % crossword.size.x), (int) (rng() % crossword.size.y)};
+        bool across = rng() % 2 == 0;
+        Vec<Answer> &answers = across ? crossword.across : crossword.down;
+        switch (letters_only ? 0 : rng() % 6) {
+            case 0:
+                crossword.set(coord, (char) ('A' + rng() % 26));
+                break;
+            case 1:
+                crossword.set(coord, '\0');
+                break;
+            case 2:
+                crossword.erase(coord);
+                break;
+            case 3:
+                add_clue(crossword, across, coord, "New clue");
+                break;
+            case 4:
+                if (answers.size() > 0) {
+                    crossword.remove_answer(across, (int) (rng() % answers.size()));
+                }
+                break;
+            case 5:
+                if (answers.size() > 0) {
+                    int i = (int) (rng() % answers.size());
+                    int position = (int) (rng() % (strlen(answers[i].hint) + 1));
+                    crossword.set_hint(across, i, position, rng() % 4 == 0 ? '\0' : (char) ('a' + rng() % 26));
+                }
+                break;
+        }
+    }
+    crossword.end_step();
+}
+
+static void check_undo() {
+    printf("undo and redo\n");
+
+    // states[i] is the puzzle after step i
+    std::mt19937 rng(21);
+    Crossword crossword({7, 7}, "Undo");
+    std::vector<std::string> states = {text_of(crossword)};
+    const int steps = 2000;
+    for (int step = 0; step < steps; ++step) {
+        random_step(crossword, rng, false);
+        states.push_back(text_of(crossword));
+    }
+
+    int wrong = 0;
+    for (int step = steps; step > 0; --step) {
+        wrong += !crossword.undo() || text_of(crossword) != states[step - 1];
+    }
+    CHECK(!crossword.undo());
+    for (int step = 1; step <= steps; ++step) {
+        wrong += !crossword.redo() || text_of(crossword) != states[step];
+    }
+    CHECK(!crossword.redo());
+    CHECK(wrong == 0);
+
+    // A new step after an undo takes the place of what could have been redone
+    crossword.undo();
+    crossword.undo();
+    random_step(crossword, rng, false);
+    CHECK(!crossword.redo());
+    CHECK(crossword.undo());
+    CHECK(text_of(crossword) == states[steps - 2]);
+
+    // Far more steps than the journal holds: the oldest are dropped whole, and what is left
+    // still undoes back to the state before the oldest step kept
+    Crossword evicted({7, 7}, "Evicted");
+    states = {text_of(evicted)};
+    const int many = 200000;
+    for (int step = 0; step < many; ++step) {
+        random_step(evicted, rng, step % 8 != 0);
+        states.push_back(text_of(evicted));
+    }
+    int undone = 0;
+    wrong = 0;
+    while (evicted.undo()) {
+        undone += 1;
+        wrong += text_of(evicted) != states[many - undone];
+    }
+    CHECK(undone > 0 && undone < many);
+    CHECK(wrong == 0);
+    printf("  %d of %d steps were kept\n", undone, many);
+    for (int step = many - undone + 1; step <= many; ++step) {
+        wrong += !evicted.redo() || text_of(evicted) != states[step];
+    }
+    CHECK(!evicted.redo());
+    CHECK(wrong == 0);
+
+    // A step bigger than the whole journal can't be undone, and neither can anything before
+    Crossword huge({400, 400}, "Huge");
+    huge.set({0, 0}, 'A');
+    huge.end_step();
+    for (int y = 0; y < huge.size.y; ++y) {
+        for (int x = 0; x < huge.size.x; ++x) {
+            huge.set({x, y}, 'B');
+        }
+    }
+    huge.end_step();
+    CHECK(!huge.undo());
+    CHECK(huge.at({399, 399}) == 'B');
+}
+
+int main() {
+    char dir[] = "/tmp/shareword_check.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        printf("could not make a temporary directory\n");
+        return 1;
+    }
+
+    check_round_trips(dir);
+    check_errors();
+    check_undo();
+
+    std::string clean = std::string("rm -rf ") + dir;
+    if (system(clean.c_str()) != 0) {
+        printf("could not remove %s\n", dir);
+    }
+
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
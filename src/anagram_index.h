@@ -0,0 +1,240 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "./dictionary.h"
+
+using namespace jovial;
+
+// Words looked at between two looks at whether the build or query is still wanted
+#define ANAGRAM_INDEX_CANCEL_EVERY 4096
+
+// Which letters a word holds at least once, twice and three times, one bit per letter in
+// each level. Comparing two of these counts missing letters exactly as long as the word has
+// no more than three of any letter; many() marks the words where that isn't the case.
+struct LetterLevels {
+    uint32_t at_least[3] = {};
+
+    [[nodiscard]] bool many() const {
+        return (at_least[0] >> 31) != 0;
+    }
+
+    // Whether spelling `word` from these letters takes more than `blanks` blanks. Stops at the
+    // first blank too many. It is exact unless word.many(), and never wrongly true.
+    [[nodiscard]] bool needs_more_than(const LetterLevels &word, int blanks) const {
+        const uint32_t letters = ((uint32_t) 1 << DICTIONARY_LETTERS) - 1;
+        int missing = 0;
+        for (int level = 0; level < 3; ++level) {
+            uint32_t lacking = word.at_least[level] & ~at_least[level] & letters;
+            while (lacking != 0) {
+                if (++missing > blanks) return true;
+                lacking &= lacking - 1;
+            }
+        }
+        return false;
+    }
+};
+
+// How many of each letter a word or a rack holds. Anything that isn't a letter, like the
+// apostrophe in "don't", is ignored.
+struct LetterCounts {
+    uint8_t counts[DICTIONARY_LETTERS] = {};
+    int letters = 0;
+
+    static LetterCounts of(StringView word) {
+        LetterCounts result;
+        for (size_t i = 0; i < word.size(); ++i) {
+            result.add(word[i]);
+        }
+        return result;
+    }
+
+    void add(char c) {
+        int letter = letter_index(c);
+        if (letter != -1 && counts[letter] < UINT8_MAX) {
+            counts[letter] += 1;
+            letters += 1;
+        }
+    }
+
+    bool operator==(const LetterCounts &other) const {
+        return letters == other.letters && memcmp(counts, other.counts, sizeof(counts)) == 0;
+    }
+
+    // Same for every anagram of a word, FNV-1a over the counts.
+    [[nodiscard]] uint64_t signature() const {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint8_t count: counts) {
+            hash = (hash ^ count) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    [[nodiscard]] LetterLevels levels() const {
+        LetterLevels result;
+        for (int letter = 0; letter < DICTIONARY_LETTERS; ++letter) {
+            for (int level = 0; level < 3 && level < counts[letter]; ++level) {
+                result.at_least[level] |= (uint32_t) 1 << letter;
+            }
+            if (counts[letter] > 3) {
+                result.at_least[0] |= (uint32_t) 1 << 31;
+            }
+        }
+        return result;
+    }
+
+    // How many blanks it takes to spell `word` from these letters.
+    [[nodiscard]] int missing_for(const LetterCounts &word) const {
+        int missing = 0;
+        for (int letter = 0; letter < DICTIONARY_LETTERS; ++letter) {
+            if (word.counts[letter] > counts[letter]) {
+                missing += word.counts[letter] - counts[letter];
+            }
+        }
+        return missing;
+    }
+};
+
+// The letters typed in anagram mode. '_' is a blank that stands for any letter, and a
+// trailing '*' asks for every word that fits in the rack instead of ones that use all of it.
+struct AnagramQuery {
+    LetterCounts rack;
+    int blanks = 0;
+    bool partial = false;
+
+    static AnagramQuery parse(const char *text, int len) {
+        AnagramQuery query;
+        for (int i = 0; i < len; ++i) {
+            if (text[i] == '_') {
+                query.blanks += 1;
+            } else if (text[i] == '*' && i == len - 1) {
+                query.partial = true;
+            } else {
+                query.rack.add(text[i]);
+            }
+        }
+        return query;
+    }
+};
+
+// Answers letter multiset questions without permuting anything. Exact anagrams are looked up
+// by signature in a sorted table. Everything with blanks or a partial rack scans the
+// LetterLevels of the words with a fitting number of letters, which are grouped together,
+// and only counts letters for words like "mississippi".
+struct AnagramIndex {
+    struct Entry {
+        uint64_t signature;
+        uint32_t id;
+    };
+
+    void build(const Dictionary &dictionary) {
+        build(dictionary, [] { return false; });
+    }
+
+    // Gives up, leaving the index unbuilt, once stopped() returns true. It is asked every
+    // ANAGRAM_INDEX_CANCEL_EVERY words, but not during the sort. Returns whether it finished.
+    template<typename S>
+    bool build(const Dictionary &dictionary, S &&stopped) {
+        built = false;
+        entries.clear();
+        ids.clear();
+        levels.clear();
+
+        Vec<uint8_t> letters;
+        uint32_t group_size[UINT8_MAX + 1] = {};
+        for (uint32_t id = 0; id < dictionary.word_count; ++id) {
+            if (id % ANAGRAM_INDEX_CANCEL_EVERY == 0 && stopped()) return false;
+            LetterCounts counts = LetterCounts::of(dictionary.word(id));
+            entries.push_back({counts.signature(), id});
+            letters.push_back((uint8_t) math::min(counts.letters, (int) UINT8_MAX));
+            group_size[letters[id]] += 1;
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            if (a.signature != b.signature) return a.signature < b.signature;
+            return a.id < b.id;
+        });
+
+        group_start[0] = 0;
+        for (int group = 0; group <= UINT8_MAX; ++group) {
+            group_start[group + 1] = group_start[group] + group_size[group];
+        }
+        for (uint32_t i = 0; i < dictionary.word_count; ++i) {
+            ids.push_back(0);
+            levels.push_back({});
+        }
+        uint32_t next[UINT8_MAX + 1];
+        memcpy(next, group_start, sizeof(next));
+        for (uint32_t id = 0; id < dictionary.word_count; ++id) {
+            if (id % ANAGRAM_INDEX_CANCEL_EVERY == 0 && stopped()) return false;
+            uint32_t at = next[letters[id]]++;
+            ids[at] = id;
+            levels[at] = LetterCounts::of(dictionary.word(id)).levels();
+        }
+        built = true;
+        return true;
+    }
+
+    [[nodiscard]] bool is_built() const {
+        return built;
+    }
+
+    // Calls on_match(id) for every word the query allows until it returns false.
+    template<typename F>
+    void query(const Dictionary &dictionary, const AnagramQuery &query, F &&on_match) const {
+        this->query(dictionary, query, on_match, [] { return false; });
+    }
+
+    // Also stops once stopped() returns true, which is asked every ANAGRAM_INDEX_CANCEL_EVERY
+    // words scanned for racks with blanks or a '*'.
+    template<typename F, typename S>
+    void query(const Dictionary &dictionary, const AnagramQuery &query, F &&on_match, S &&stopped) const {
+        if (query.rack.letters + query.blanks == 0) return;
+
+        if (!query.partial && query.blanks == 0) {
+            for_each_anagram(dictionary, query.rack, on_match);
+        } else {
+            for_each_fit(dictionary, query, on_match, stopped);
+        }
+    }
+
+private:
+    template<typename F>
+    void for_each_anagram(const Dictionary &dictionary, const LetterCounts &rack, F &&on_match) const {
+        uint64_t signature = rack.signature();
+        const Entry *first = std::lower_bound(entries.begin(), entries.end(), signature, [](const Entry &entry, uint64_t s) {
+            return entry.signature < s;
+        });
+        for (const Entry *entry = first; entry != entries.end() && entry->signature == signature; ++entry) {
+            // Different counts can share a signature, however unlikely
+            if (LetterCounts::of(dictionary.word(entry->id)) == rack && !on_match(entry->id)) return;
+        }
+    }
+
+    template<typename F, typename S>
+    void for_each_fit(const Dictionary &dictionary, const AnagramQuery &query, F &&on_match, S &&stopped) const {
+        int most = math::min(query.rack.letters + query.blanks, (int) UINT8_MAX);
+        LetterLevels rack = query.rack.levels();
+
+        for (int group = query.partial ? 1 : most; group <= most; ++group) {
+            for (uint32_t i = group_start[group]; i < group_start[group + 1]; ++i) {
+                if ((i - group_start[group]) % ANAGRAM_INDEX_CANCEL_EVERY == 0 && stopped()) return;
+                // For many() words the levels undercount, so passing them still needs a recount
+                if (rack.needs_more_than(levels[i], query.blanks)) continue;
+                if (levels[i].many() && query.rack.missing_for(LetterCounts::of(dictionary.word(ids[i]))) > query.blanks) continue;
+                if (!on_match(ids[i])) return;
+            }
+        }
+    }
+
+    bool built = false;
+    Vec<Entry> entries;
+
+    // Word ids grouped by how many letters they have, and the levels of each
+    uint32_t group_start[UINT8_MAX + 2] = {};
+    Vec<uint32_t> ids;
+    Vec<LetterLevels> levels;
+};
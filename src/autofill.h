@@ -0,0 +1,819 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+
+#include "./crossword.h"
+#include "./dictionary.h"
+#include "./pattern.h"
+#include "./slot_table.h"
+
+using namespace jovial;
+
+// Words tried before the first restart
+#define AUTOFILL_FIRST_RESTART 256
+
+enum class AutofillStatus {
+    Filled,
+    NoFill,
+    TooLong,
+    Cancelled,
+};
+
+[[nodiscard]] inline const char *autofill_status_text(AutofillStatus status) {
+    switch (status) {
+        case AutofillStatus::Filled:
+            return "Filled";
+        case AutofillStatus::NoFill:
+            return "No fill exists with this word list";
+        case AutofillStatus::TooLong:
+            return "A run is longer than any word";
+        case AutofillStatus::Cancelled:
+            return "Cancelled";
+    }
+    return "";
+}
+
+// One across or down run of white cells, and the run crossing it at each position.
+struct FillSlot {
+    Vector2i start;
+    bool across = true;
+    int len = 0;
+    int cells[DICTIONARY_MAX_WORD_LEN] = {};
+    int crossing[DICTIONARY_MAX_WORD_LEN] = {};
+};
+
+struct FillDecision {
+    int slot;
+    uint32_t index;
+};
+
+// A subtree of the search: the words placed on the way to it, and the words still to try
+// in the slot after that. The root task has no path and no slot.
+struct FillTask {
+    Vec<FillDecision> path;
+    int slot = -1;
+    Vec<uint32_t> words;
+};
+
+enum class FillResult {
+    Filled,
+    Exhausted,
+    Interrupted,
+};
+
+// Fills the open cells of a grid so that every across and down run is a dictionary word.
+// '\0' is a block, letters are kept as they are, and any other character, like a '.' typed
+// into a square that should be filled, is open.
+//
+// Each slot's domain is a bitset over its length bucket, so narrowing it to the letters a
+// cell still allows is a few ORs of posting bitsets per 64 words. Cells hold the letters
+// both crossing slots still allow, and narrowing one slot narrows the cells it shares,
+// which in turn narrows the crossing slots until nothing changes (arc consistency).
+//
+// The search fills the slot with the fewest words left, weighed by how often it ran dry
+// before, and tries the best scoring words first. Every domain remembers which decisions
+// narrowed it, so a dead end jumps straight back to the latest decision that had a part in
+// it, and a word that fails without any earlier decision to blame is never tried in that
+// slot again. What was learned carries over the restarts, which get a growing budget.
+struct Autofill {
+    AutofillStatus fill(const Dictionary &dictionary, Crossword &crossword, const std::atomic<bool> *cancel = nullptr) {
+        return fill(dictionary, crossword.slots, crossword.letters, cancel);
+    }
+
+    AutofillStatus fill(const Dictionary &dictionary, Vector2i size, char *letters, const std::atomic<bool> *cancel = nullptr) {
+        SlotTable table;
+        table.build(size, letters);
+        return fill(dictionary, table, letters, cancel);
+    }
+
+    // The dictionary must be ready and `table` must hold the runs of `letters`, which is
+    // only written when a fill was found.
+    AutofillStatus fill(const Dictionary &dictionary, const SlotTable &table, char *letters, const std::atomic<bool> *cancel = nullptr) {
+        AutofillStatus status;
+        if (!start(dictionary, table, letters, &status)) return status;
+
+        // Restarts keep the bans and slot weights learned so far, with a growing budget so
+        // the search stays complete
+        size_t budget = AUTOFILL_FIRST_RESTART;
+        while (true) {
+            SerialHooks hooks{cancel, nodes + budget};
+            FillResult result = run(FillTask(), hooks);
+            if (result == FillResult::Filled) {
+                write_fill(letters);
+                return AutofillStatus::Filled;
+            }
+            if (result == FillResult::Exhausted) return AutofillStatus::NoFill;
+            if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) return AutofillStatus::Cancelled;
+
+            restarts += 1;
+            budget += budget / 2;
+        }
+    }
+
+    // Takes the slots of the grid from `table` and narrows them to what the grid allows.
+    // Returns false, with the reason in `status`, when that already rules out any fill.
+    bool start(const Dictionary &dictionary, const SlotTable &table, const char *letters, AutofillStatus *status) {
+        this->dictionary = &dictionary;
+        nodes = 0;
+        backjumps = 0;
+        restarts = 0;
+        failed_slot = -1;
+
+        if (!find_slots(table, letters)) {
+            *status = AutofillStatus::TooLong;
+            return false;
+        }
+        prepare();
+        if (!propagate(0)) {
+            *status = AutofillStatus::NoFill;
+            return false;
+        }
+        root_trail = trail.size();
+        root_cells = cell_trail.size();
+        return true;
+    }
+
+    // Searches the subtree of `task`. Each word tried first asks hooks.interrupted(nodes)
+    // whether to give up. Whenever hooks.hungry(), the untried half of the shallowest level
+    // that has any left is split off and handed to hooks.give(FillTask *), which owns it
+    // from then on. On Filled the words stay placed for write_fill(); otherwise everything
+    // is back to how start() left it.
+    template<typename Hooks>
+    FillResult run(const FillTask &task, Hooks &hooks) {
+        int level = 1;
+        bool replayed = true;
+        for (const FillDecision &decision: task.path) {
+            uint32_t id = dictionary->buckets[slots[decision.slot].len].ids[decision.index];
+            // This worker may have banned a word since the task was split off
+            if (!in_domain(decision.slot, decision.index) || used_by[id] != -1) {
+                replayed = false;
+                break;
+            }
+            level_slot[level] = decision.slot;
+            assign(decision.slot, decision.index, level);
+            used_by[id] = decision.slot;
+            if (!propagate(level)) {
+                replayed = false;
+                break;
+            }
+            level += 1;
+        }
+        first_level = level;
+
+        int result = 0;
+        if (replayed && task.slot == -1) {
+            result = solve(level, hooks);
+        } else if (replayed && assigned[task.slot] == UINT32_MAX) {
+            size_t start = candidates.size();
+            for (uint32_t index: task.words) {
+                candidates.push_back(index);
+            }
+            level_partial[level] = 1;
+            result = try_words(level, task.slot, start, hooks);
+        }
+
+        if (result == SOLVE_FILLED) return FillResult::Filled;
+        rewind();
+        return result == SOLVE_INTERRUPTED ? FillResult::Interrupted : FillResult::Exhausted;
+    }
+
+    // Takes back every word placed since start().
+    void rewind() {
+        for (size_t s = 0; s < slots.size(); ++s) {
+            if (assigned[s] != UINT32_MAX) {
+                used_by[dictionary->buckets[slots[s].len].ids[assigned[s]]] = -1;
+                assigned[s] = UINT32_MAX;
+            }
+        }
+        undo(root_trail, root_cells);
+        clear_queue();
+        candidates.clear();
+    }
+
+    void write_fill(char *letters) const {
+        for (size_t s = 0; s < slots.size(); ++s) {
+            const FillSlot &slot = slots[s];
+            const uint8_t *row = word_row(s, assigned[s]);
+            for (int p = 0; p < slot.len; ++p) {
+                letters[slot.cells[p]] = (char) toupper(row[p]);
+            }
+        }
+    }
+
+    // What the search learned, to carry over into another Autofill of the same grid
+    [[nodiscard]] const Vec<uint64_t> &learned_bans() const {
+        return banned;
+    }
+
+    [[nodiscard]] const Vec<uint32_t> &slot_weights() const {
+        return weights;
+    }
+
+    void adopt(const Vec<uint64_t> &bans, const Vec<uint32_t> &slot_weights) {
+        for (size_t i = 0; i < banned.size(); ++i) {
+            banned[i] |= bans[i];
+        }
+        for (size_t s = 0; s < weights.size(); ++s) {
+            weights[s] = slot_weights[s];
+        }
+    }
+
+    Vec<FillSlot> slots;
+
+    // Statistics of the last fill
+    size_t nodes = 0;
+    size_t backjumps = 0;
+    size_t restarts = 0;
+    // The slot whose run is too long or that no word fits even before searching, or -1
+    int failed_slot = -1;
+
+private:
+    static constexpr int SOLVE_FILLED = -1;
+    static constexpr int SOLVE_INTERRUPTED = -2;
+
+    // Gives up on cancellation or at the restart budget, and never splits
+    struct SerialHooks {
+        const std::atomic<bool> *cancel;
+        size_t restart_at;
+
+        [[nodiscard]] bool interrupted(size_t nodes) const {
+            return nodes >= restart_at || (cancel != nullptr && cancel->load(std::memory_order_relaxed));
+        }
+
+        [[nodiscard]] static bool hungry() {
+            return false;
+        }
+
+        static void give(FillTask *task) {
+            delete task;
+        }
+    };
+
+    // A slot's state before the level that first changed it
+    struct Saved {
+        int slot;
+        int previous_level;
+        uint32_t size;
+        size_t words;
+    };
+
+    struct SavedCell {
+        int cell;
+        uint32_t mask;
+    };
+
+    // Copies the runs of the table, numbered from 0 in table order, with their cells and the
+    // runs crossing them.
+    bool find_slots(const SlotTable &table, const char *letters) {
+        slots.clear();
+        cell_masks.clear();
+        for (int i = 0; i < table.size.x * table.size.y; ++i) {
+            char c = letters[i];
+            cell_masks.push_back(c == '\0' ? 0 : isalpha((unsigned char) c) ? pattern_bit(c) : PATTERN_LETTERS);
+        }
+
+        Vec<int> slot_of;
+        Vec<int> table_ids;
+        for (size_t id = 0; id < table.slots.size(); ++id) {
+            const Slot &run = table.slots[id];
+            slot_of.push_back(run.len > 0 ? (int) slots.size() : -1);
+            if (run.len == 0) continue;
+
+            FillSlot slot;
+            slot.start = run.start;
+            slot.across = run.across;
+            slot.len = run.len;
+            if (run.len > DICTIONARY_MAX_WORD_LEN) {
+                failed_slot = (int) slots.size();
+                slots.push_back(slot);
+                return false;
+            }
+            for (int p = 0; p < run.len; ++p) {
+                slot.cells[p] = table.cell((int) id, p);
+            }
+            slots.push_back(slot);
+            table_ids.push_back((int) id);
+        }
+
+        for (size_t s = 0; s < slots.size(); ++s) {
+            for (int p = 0; p < slots[s].len; ++p) {
+                int crossing = table.crossing(table_ids[s], p);
+                slots[s].crossing[p] = crossing == -1 ? -1 : slot_of[crossing];
+            }
+        }
+        return true;
+    }
+
+    template<typename T>
+    static void reset(Vec<T> &vec, size_t count, T value) {
+        vec.clear();
+        for (size_t i = 0; i < count; ++i) {
+            vec.push_back(value);
+        }
+    }
+
+    void prepare() {
+        size_t slot_count = slots.size();
+        level_words = (slot_count + 2 + 63) / 64;
+
+        offsets.clear();
+        size_t total = 0;
+        for (const FillSlot &slot: slots) {
+            offsets.push_back(total);
+            total += dictionary->buckets[slot.len].blocks;
+        }
+        offsets.push_back(total);
+
+        // Every domain starts out as the words of its length that are letters only
+        domains.clear();
+        for (const FillSlot &slot: slots) {
+            const LengthBucket &bucket = dictionary->buckets[slot.len];
+            for (size_t block = 0; block < bucket.blocks; ++block) {
+                uint64_t bits = bucket.valid(block);
+                for (int p = 0; p < slot.len && bits != 0; ++p) {
+                    bits &= ~bucket.allowed(p, PATTERN_OTHER_BIT, block);
+                }
+                domains.push_back(bits);
+            }
+        }
+        reset(banned, total, (uint64_t) 0);
+        reset(sizes, slot_count, (uint32_t) 0);
+        reset(weights, slot_count, (uint32_t) 1);
+        for (size_t s = 0; s < slot_count; ++s) {
+            sizes[s] = count_domain(s);
+        }
+
+        reset(applied, slot_count * DICTIONARY_MAX_WORD_LEN, PATTERN_LETTERS);
+        reset(blame, slot_count * level_words, (uint64_t) 0);
+        reset(saved_level, slot_count, -1);
+        reset(assigned, slot_count, UINT32_MAX);
+        reset(assigned_level, slot_count, 0);
+        reset(used_by, (size_t) dictionary->word_count, -1);
+        reset(in_queue, slot_count, (uint8_t) 0);
+        reset(conflicts, (slot_count + 2) * level_words, (uint64_t) 0);
+        reset(level_slot, slot_count + 2, -1);
+        reset(level_next, slot_count + 2, (size_t) 0);
+        reset(level_end, slot_count + 2, (size_t) 0);
+        reset(level_partial, slot_count + 2, (uint8_t) 0);
+        reset(last_conflict, level_words, (uint64_t) 0);
+        reset(wipeout, level_words, (uint64_t) 0);
+        trail.clear();
+        trail_words.clear();
+        trail_masks.clear();
+        cell_trail.clear();
+        queue.clear();
+        candidates.clear();
+
+        for (size_t s = 0; s < slot_count; ++s) {
+            enqueue((int) s);
+        }
+    }
+
+    // Decision levels start at 1, and there is one per slot at most.
+    template<typename Hooks>
+    int solve(int level, Hooks &hooks) {
+        int s = choose_slot();
+        if (s == -1) return SOLVE_FILLED;
+
+        size_t start = candidates.size();
+        gather_candidates(s);
+        level_partial[level] = 0;
+        return try_words(level, s, start, hooks);
+    }
+
+    // Tries candidates[start...] in slot `s`. Returns SOLVE_FILLED, SOLVE_INTERRUPTED or the
+    // level to jump back to, with the reason in last_conflict. A level that doesn't see all
+    // words of its slot, because some went to another task, is partial: its reason doesn't
+    // cover those, so nothing is banned on its account.
+    template<typename Hooks>
+    int try_words(int level, int s, size_t start, Hooks &hooks) {
+        level_slot[level] = s;
+        level_end[level] = candidates.size();
+
+        // Words already gone from this slot were ruled out by whatever narrowed it
+        uint64_t *conflict = &conflicts[(size_t) level * level_words];
+        memcpy(conflict, &blame[(size_t) s * level_words], level_words * sizeof(uint64_t));
+
+        for (level_next[level] = start; level_next[level] < level_end[level]; ++level_next[level]) {
+            uint32_t index = candidates[level_next[level]];
+            if (!in_domain(s, index)) continue;
+            if (hooks.interrupted(nodes)) return SOLVE_INTERRUPTED;
+            nodes += 1;
+
+            uint32_t id = dictionary->buckets[slots[s].len].ids[index];
+            if (used_by[id] != -1) {
+                // The same word twice is blamed on whoever placed it first
+                set_level(conflict, assigned_level[used_by[id]]);
+                continue;
+            }
+
+            size_t trail_mark = trail.size();
+            size_t cell_mark = cell_trail.size();
+            assign(s, index, level);
+            used_by[id] = s;
+
+            int result = SOLVE_FILLED;
+            bool consistent = propagate(level);
+            if (consistent) {
+                if (hooks.hungry()) {
+                    split(level, hooks);
+                }
+                result = solve(level + 1, hooks);
+                if (result == SOLVE_FILLED || result == SOLVE_INTERRUPTED) return result;
+            }
+
+            used_by[id] = -1;
+            assigned[s] = UINT32_MAX;
+            undo(trail_mark, cell_mark);
+            clear_queue();
+
+            if (consistent && result < level) {
+                // Nothing this level could try would help; last_conflict goes on up
+                truncate(candidates, start);
+                return result;
+            }
+
+            uint64_t *reason = consistent ? last_conflict.begin() : wipeout.begin();
+            clear_level(reason, level);
+            bool blameless = true;
+            for (size_t w = 0; w < level_words; ++w) {
+                conflict[w] |= reason[w];
+                blameless = blameless && reason[w] == 0;
+            }
+            if (consistent && last_partial) {
+                level_partial[level] = 1;
+            } else if (blameless) {
+                ban(s, index);
+            }
+        }
+        truncate(candidates, start);
+
+        clear_level(conflict, level);
+        memcpy(last_conflict.begin(), conflict, level_words * sizeof(uint64_t));
+        last_partial = level_partial[level] != 0;
+        int target = highest_level(conflict);
+        if (target < level - 1) {
+            backjumps += 1;
+        }
+        // Level 0 means the grid can't be filled at all
+        return target;
+    }
+
+    // Hands the later half of the untried words of the shallowest level that has any left
+    // to another task. Every level above it has nothing left to try, so jumping back over
+    // them never skips words of this task.
+    template<typename Hooks>
+    void split(int level, Hooks &hooks) {
+        for (int l = first_level; l <= level; ++l) {
+            size_t left = level_end[l] - level_next[l] - 1;
+            if (level_next[l] >= level_end[l] || left == 0) continue;
+
+            size_t give = (left + 1) / 2;
+            auto *task = new FillTask;
+            for (int k = 1; k < l; ++k) {
+                task->path.push_back({level_slot[k], assigned[level_slot[k]]});
+            }
+            task->slot = level_slot[l];
+            for (size_t i = level_end[l] - give; i < level_end[l]; ++i) {
+                task->words.push_back(candidates[i]);
+            }
+            level_end[l] -= give;
+            level_partial[l] = 1;
+            hooks.give(task);
+            return;
+        }
+    }
+
+    int choose_slot() const {
+        int best = -1;
+        for (size_t s = 0; s < slots.size(); ++s) {
+            if (assigned[s] != UINT32_MAX) continue;
+            if (best == -1) {
+                best = (int) s;
+                continue;
+            }
+            uint64_t here = (uint64_t) sizes[s] * weights[best];
+            uint64_t there = (uint64_t) sizes[best] * weights[s];
+            if (here < there || (here == there && slots[s].len > slots[best].len)) {
+                best = (int) s;
+            }
+        }
+        return best;
+    }
+
+    // The words of slot `s` in the order they are tried, appended to `candidates`.
+    void gather_candidates(int s) {
+        const LengthBucket &bucket = dictionary->buckets[slots[s].len];
+        const uint64_t *domain = &domains[offsets[s]];
+        size_t start = candidates.size();
+        for (size_t block = 0; block < bucket.blocks; ++block) {
+            for (uint64_t bits = domain[block]; bits != 0; bits &= bits - 1) {
+                candidates.push_back((uint32_t) (block * 64 + __builtin_ctzll(bits)));
+            }
+        }
+        std::sort(candidates.begin() + start, candidates.end(), [&](uint32_t a, uint32_t b) {
+            uint16_t score_a = dictionary->scores[bucket.ids[a]];
+            uint16_t score_b = dictionary->scores[bucket.ids[b]];
+            if (score_a != score_b) return score_a > score_b;
+            return a < b;
+        });
+    }
+
+    void assign(int s, uint32_t index, int level) {
+        const FillSlot &slot = slots[s];
+        save(s, level);
+        uint64_t *domain = &domains[offsets[s]];
+        memset(domain, 0, (offsets[s + 1] - offsets[s]) * sizeof(uint64_t));
+        domain[index / 64] = (uint64_t) 1 << (index % 64);
+        sizes[s] = 1;
+        assigned[s] = index;
+        assigned_level[s] = level;
+        set_level(&blame[(size_t) s * level_words], level);
+
+        // The crossing cells change because of this decision alone
+        const uint8_t *row = word_row(s, index);
+        for (int p = 0; p < slot.len; ++p) {
+            applied[(size_t) s * DICTIONARY_MAX_WORD_LEN + p] = pattern_bit((char) row[p]);
+            uint32_t letter = pattern_bit((char) row[p]);
+            int cell = slot.cells[p];
+            if (cell_masks[cell] == letter) continue;
+
+            cell_trail.push_back({cell, cell_masks[cell]});
+            cell_masks[cell] = letter;
+            int other = slot.crossing[p];
+            if (other != -1 && assigned[other] == UINT32_MAX) {
+                save(other, level);
+                set_level(&blame[(size_t) other * level_words], level);
+                enqueue(other);
+            }
+        }
+    }
+
+    // Narrows every queued slot to its cells and its cells to the slot, until nothing changes.
+    // On a wipeout, `wipeout` holds the levels to blame.
+    bool propagate(int level) {
+        while (queue.size() > 0) {
+            int s = queue.back();
+            queue.pop_back();
+            in_queue[s] = 0;
+
+            if (!narrow(s, level)) {
+                memcpy(wipeout.begin(), &blame[(size_t) s * level_words], level_words * sizeof(uint64_t));
+                weights[s] += 1;
+                if (level == 0) {
+                    failed_slot = s;
+                }
+                clear_queue();
+                return false;
+            }
+            if (assigned[s] == UINT32_MAX) {
+                narrow_cells(s, level);
+            }
+        }
+        return true;
+    }
+
+    bool narrow(int s, int level) {
+        const FillSlot &slot = slots[s];
+        const LengthBucket &bucket = dictionary->buckets[slot.len];
+        uint32_t *slot_applied = &applied[(size_t) s * DICTIONARY_MAX_WORD_LEN];
+
+        int changed[DICTIONARY_MAX_WORD_LEN];
+        int changed_count = 0;
+        for (int p = 0; p < slot.len; ++p) {
+            if (cell_masks[slot.cells[p]] != slot_applied[p]) {
+                changed[changed_count++] = p;
+            }
+        }
+        if (changed_count == 0) return sizes[s] > 0;
+
+        save(s, level);
+        uint64_t *domain = &domains[offsets[s]];
+        const uint64_t *slot_banned = &banned[offsets[s]];
+        uint32_t size = 0;
+        for (size_t block = 0; block < bucket.blocks; ++block) {
+            uint64_t bits = domain[block] & ~slot_banned[block];
+            for (int i = 0; i < changed_count && bits != 0; ++i) {
+                bits &= letters_in(bucket, changed[i], cell_masks[slot.cells[changed[i]]], block);
+            }
+            domain[block] = bits;
+            size += __builtin_popcountll(bits);
+        }
+        for (int i = 0; i < changed_count; ++i) {
+            slot_applied[changed[i]] = cell_masks[slot.cells[changed[i]]];
+        }
+        sizes[s] = size;
+        return size > 0;
+    }
+
+    // Which words of a letters-only domain block have one of `mask` at `position`, going
+    // through whichever of the mask and the letters it leaves out has fewer postings.
+    static uint64_t letters_in(const LengthBucket &bucket, int position, uint32_t mask, size_t block) {
+        if (__builtin_popcount(mask) <= DICTIONARY_LETTERS / 2) {
+            return bucket.allowed(position, mask, block);
+        }
+        return bucket.allowed(position, PATTERN_OTHER_BIT | mask, block);
+    }
+
+    // Shrinks the crossed cells of slot `s` to the letters its words still have there.
+    void narrow_cells(int s, int level) {
+        const FillSlot &slot = slots[s];
+        const LengthBucket &bucket = dictionary->buckets[slot.len];
+        const uint64_t *domain = &domains[offsets[s]];
+        bool read_rows = sizes[s] <= bucket.blocks * 4;
+
+        for (int p = 0; p < slot.len; ++p) {
+            int other = slot.crossing[p];
+            if (other == -1 || assigned[other] != UINT32_MAX) continue;
+            int cell = slot.cells[p];
+            uint32_t mask = cell_masks[cell];
+            if ((mask & (mask - 1)) == 0) continue;
+
+            uint32_t support = 0;
+            if (read_rows) {
+                for (size_t block = 0; block < bucket.blocks; ++block) {
+                    for (uint64_t bits = domain[block]; bits != 0; bits &= bits - 1) {
+                        size_t index = block * 64 + __builtin_ctzll(bits);
+                        support |= pattern_bit((char) bucket.rows[index * bucket.stride + p]);
+                    }
+                }
+            } else {
+                for (uint32_t letters = mask; letters != 0; letters &= letters - 1) {
+                    int letter = __builtin_ctz(letters);
+                    const uint64_t *posting = bucket.posting(p, letter);
+                    for (size_t block = 0; block < bucket.blocks; ++block) {
+                        if ((domain[block] & posting[block]) != 0) {
+                            support |= (uint32_t) 1 << letter;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            uint32_t narrowed = mask & support;
+            if (narrowed == mask) continue;
+            cell_trail.push_back({cell, mask});
+            cell_masks[cell] = narrowed;
+
+            save(other, level);
+            uint64_t *other_blame = &blame[(size_t) other * level_words];
+            const uint64_t *slot_blame = &blame[(size_t) s * level_words];
+            for (size_t w = 0; w < level_words; ++w) {
+                other_blame[w] |= slot_blame[w];
+            }
+            enqueue(other);
+        }
+    }
+
+    // Copies what a slot looked like before `level` changed it, once per level.
+    void save(int s, int level) {
+        if (saved_level[s] == level) return;
+
+        size_t blocks = offsets[s + 1] - offsets[s];
+        trail.push_back({s, saved_level[s], sizes[s], blocks});
+        for (size_t i = 0; i < blocks; ++i) {
+            trail_words.push_back(domains[offsets[s] + i]);
+        }
+        for (size_t w = 0; w < level_words; ++w) {
+            trail_words.push_back(blame[(size_t) s * level_words + w]);
+        }
+        for (int p = 0; p < DICTIONARY_MAX_WORD_LEN; ++p) {
+            trail_masks.push_back(applied[(size_t) s * DICTIONARY_MAX_WORD_LEN + p]);
+        }
+        saved_level[s] = level;
+    }
+
+    void undo(size_t trail_mark, size_t cell_mark) {
+        while (trail.size() > trail_mark) {
+            const Saved &saved = trail.back();
+            int s = saved.slot;
+            for (int p = DICTIONARY_MAX_WORD_LEN - 1; p >= 0; --p) {
+                applied[(size_t) s * DICTIONARY_MAX_WORD_LEN + p] = trail_masks.back();
+                trail_masks.pop_back();
+            }
+            for (size_t w = level_words; w-- > 0;) {
+                blame[(size_t) s * level_words + w] = trail_words.back();
+                trail_words.pop_back();
+            }
+            for (size_t i = saved.words; i-- > 0;) {
+                domains[offsets[s] + i] = trail_words.back();
+                trail_words.pop_back();
+            }
+            sizes[s] = saved.size;
+            saved_level[s] = saved.previous_level;
+            trail.pop_back();
+        }
+        while (cell_trail.size() > cell_mark) {
+            cell_masks[cell_trail.back().cell] = cell_trail.back().mask;
+            cell_trail.pop_back();
+        }
+    }
+
+    // Rules a word out of a slot for the rest of the fill. Domains of outer levels get it
+    // taken out when they are narrowed again, and it is never tried in the meantime.
+    void ban(int s, uint32_t index) {
+        banned[offsets[s] + index / 64] |= (uint64_t) 1 << (index % 64);
+    }
+
+    [[nodiscard]] bool in_domain(int s, uint32_t index) const {
+        uint64_t bit = (uint64_t) 1 << (index % 64);
+        return (domains[offsets[s] + index / 64] & bit) != 0 && (banned[offsets[s] + index / 64] & bit) == 0;
+    }
+
+    [[nodiscard]] const uint8_t *word_row(size_t s, uint32_t index) const {
+        const LengthBucket &bucket = dictionary->buckets[slots[s].len];
+        return bucket.rows + (size_t) index * bucket.stride;
+    }
+
+    [[nodiscard]] uint32_t count_domain(size_t s) const {
+        uint32_t count = 0;
+        for (size_t i = offsets[s]; i < offsets[s + 1]; ++i) {
+            count += __builtin_popcountll(domains[i]);
+        }
+        return count;
+    }
+
+    void enqueue(int s) {
+        if (in_queue[s]) return;
+        in_queue[s] = 1;
+        queue.push_back(s);
+    }
+
+    void clear_queue() {
+        for (int s: queue) {
+            in_queue[s] = 0;
+        }
+        queue.clear();
+    }
+
+    template<typename T>
+    static void truncate(Vec<T> &vec, size_t count) {
+        while (vec.size() > count) {
+            vec.pop_back();
+        }
+    }
+
+    static void set_level(uint64_t *levels, int level) {
+        levels[level / 64] |= (uint64_t) 1 << (level % 64);
+    }
+
+    static void clear_level(uint64_t *levels, int level) {
+        levels[level / 64] &= ~((uint64_t) 1 << (level % 64));
+    }
+
+    [[nodiscard]] int highest_level(const uint64_t *levels) const {
+        for (size_t w = level_words; w-- > 0;) {
+            if (levels[w] != 0) return (int) (w * 64 + 63 - __builtin_clzll(levels[w]));
+        }
+        return 0;
+    }
+
+    const Dictionary *dictionary = nullptr;
+    size_t root_trail = 0;
+    size_t root_cells = 0;
+
+    // Letters each grid cell still allows, 0 for blocks
+    Vec<uint32_t> cell_masks;
+
+    // Per slot: its domain at offsets[s], how many words that is, the cell masks it was last
+    // narrowed to and the decision levels that narrowed it, one bit each
+    size_t level_words = 0;
+    Vec<size_t> offsets;
+    Vec<uint64_t> domains;
+    Vec<uint64_t> banned;
+    Vec<uint32_t> sizes;
+    Vec<uint32_t> weights;
+    Vec<uint32_t> applied;
+    Vec<uint64_t> blame;
+    Vec<int> saved_level;
+    Vec<uint32_t> assigned;
+    Vec<int> assigned_level;
+    Vec<int> used_by;
+
+    Vec<Saved> trail;
+    Vec<uint64_t> trail_words;
+    Vec<uint32_t> trail_masks;
+    Vec<SavedCell> cell_trail;
+
+    Vec<int> queue;
+    Vec<uint8_t> in_queue;
+    Vec<uint32_t> candidates;
+    Vec<uint64_t> conflicts;
+    Vec<uint64_t> last_conflict;
+    bool last_partial = false;
+
+    // Per decision level: its slot, the candidate being tried, where they end, and whether
+    // the level only sees part of its words
+    int first_level = 1;
+    Vec<int> level_slot;
+    Vec<size_t> level_next;
+    Vec<size_t> level_end;
+    Vec<uint8_t> level_partial;
+    Vec<uint64_t> wipeout;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "./parallel_autofill.h"
+#include "./crossword.h"
+#include "./dictionary.h"
+
+using namespace jovial;
+
+// Fills a copy of the grid in the background, on every core, so a fill that takes seconds
+// never holds up a frame. The fill is only written back if the grid wasn't edited in the
+// meantime.
+struct AutofillJob {
+    AutofillJob() = default;
+    AutofillJob(const AutofillJob &) = delete;
+    AutofillJob &operator=(const AutofillJob &) = delete;
+
+    // Starts filling `crossword`, or cancels the fill that is running. The dictionary must
+    // outlive the job; it is indexed first if it isn't yet.
+    void toggle(Dictionary *dictionary, const Crossword &crossword) {
+        if (running()) {
+            cancel.store(true, std::memory_order_relaxed);
+            return;
+        }
+        join();
+
+        size = crossword.size;
+        before.clear();
+        after.clear();
+        for (int i = 0; i < size.x * size.y; ++i) {
+            before.push_back(crossword.letters[i]);
+            after.push_back(crossword.letters[i]);
+        }
+        cancel.store(false, std::memory_order_relaxed);
+        done.store(false, std::memory_order_relaxed);
+        status = "Filling...";
+
+        dictionary->index_in_background();
+        thread = std::thread([this, dictionary] {
+            while (!dictionary->is_ready() && !cancel.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            result = AutofillStatus::Cancelled;
+            if (dictionary->is_ready()) {
+                result = autofill.fill(*dictionary, size, after.begin(), &cancel);
+            }
+            done.store(true, std::memory_order_release);
+        });
+    }
+
+    // Writes a finished fill into `crossword`. Returns true when the grid changed.
+    bool poll(Crossword &crossword) {
+        if (!thread.joinable() || !done.load(std::memory_order_acquire)) return false;
+        join();
+
+        status = autofill_status_text(result);
+        if (result != AutofillStatus::Filled) return false;
+
+        if (crossword.size.x != size.x || crossword.size.y != size.y ||
+            memcmp(crossword.letters, before.begin(), before.size()) != 0) {
+            status = "The grid changed while filling";
+            return false;
+        }
+        for (int i = 0; i < size.x * size.y; ++i) {
+            if (crossword.letters[i] != after[i]) {
+                crossword.set({i % size.x, i / size.x}, after[i]);
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool running() const {
+        return thread.joinable() && !done.load(std::memory_order_acquire);
+    }
+
+    ~AutofillJob() {
+        cancel.store(true, std::memory_order_relaxed);
+        join();
+    }
+
+    // What the last fill did, or nullptr before the first one
+    const char *status = nullptr;
+
+private:
+    void join() {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    std::thread thread;
+    std::atomic<bool> cancel = false;
+    std::atomic<bool> done = false;
+
+    // Only touched by the fill thread while it runs
+    ParallelAutofill autofill;
+    AutofillStatus result = AutofillStatus::Cancelled;
+    Vector2i size;
+    Vec<char> before;
+    Vec<char> after;
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector2i.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "./crossword.h"
+#include "./shareword_writer.h"
+
+using namespace jovial;
+
+#define AUTOSAVE_INTERVAL_SECONDS 30
+
+// A copy of everything a crossword saves. Kept between saves, so once it has grown to the
+// grid taking one is a few memcpys.
+struct CrosswordSnapshot {
+    void take(const Crossword &crossword) {
+        memcpy(title, crossword.title, sizeof(title));
+        size = crossword.size;
+        letters.assign(crossword.letters, crossword.letters + (size_t) size.x * size.y);
+        across.assign(crossword.across.begin(), crossword.across.end());
+        down.assign(crossword.down.begin(), crossword.down.end());
+    }
+
+    void serialize(ShareWordFormat format, ShareWordBuffer *out) const {
+        if (format == ShareWordFormat::Binary) {
+            if (write_shareword_binary(title, size, letters.data(), across, down, out)) return;
+            JV_CORE_ERROR("crossword of size ", size, " is too large for the binary format, writing it as text");
+        }
+        write_shareword_text(title, size, letters.data(), across, down, out);
+    }
+
+    void swap(CrosswordSnapshot &other) {
+        std::swap(title, other.title);
+        std::swap(size, other.size);
+        letters.swap(other.letters);
+        across.swap(other.across);
+        down.swap(other.down);
+    }
+
+    char title[SHAREWORD_MAX_TITLE_LEN + 1] = {0};
+    Vector2i size;
+    std::vector<char> letters;
+    std::vector<Answer> across;
+    std::vector<Answer> down;
+};
+
+// Saves crosswords on its own thread, so serializing a huge puzzle and waiting for the disk
+// never holds up a frame. The render thread only takes a snapshot. Saves requested before
+// the worker gets to them are merged: the newest snapshot goes to every path asked for.
+struct Autosave {
+    explicit Autosave(const fs::Path &path) : path(path.str.items, path.str.count) {}
+    Autosave(const Autosave &) = delete;
+    Autosave &operator=(const Autosave &) = delete;
+
+    // Saves to `path` in the background, in the format its name asks for.
+    void save(const Crossword &crossword, const fs::Path &path) {
+        request(crossword, std::string(path.str.items, path.str.count), false);
+    }
+
+    // Call every frame. Saves to the autosave path once every AUTOSAVE_INTERVAL_SECONDS;
+    // the file is only rewritten if the puzzle changed.
+    void update(const Crossword &crossword) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_autosave < std::chrono::seconds(AUTOSAVE_INTERVAL_SECONDS)) return;
+        last_autosave = now;
+        request(crossword, path, true);
+    }
+
+    // Waits until every save asked for so far is on disk.
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [&] {
+            return !pending && !writing;
+        });
+    }
+
+    ~Autosave() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    std::string path;
+
+private:
+    struct Target {
+        std::string path;
+        bool autosave;
+    };
+
+    void request(const Crossword &crossword, std::string target, bool autosave) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requested.take(crossword);
+            bool known = false;
+            for (const Target &t: targets) {
+                known = known || t.path == target;
+            }
+            if (!known) {
+                targets.push_back({std::move(target), autosave});
+            }
+            pending = true;
+        }
+        wake.notify_one();
+
+        if (!thread.joinable()) {
+            thread = std::thread([this] { run(); });
+        }
+    }
+
+    void run() {
+        std::vector<Target> writing_targets;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                writing = false;
+                idle.notify_all();
+                wake.wait(lock, [&] {
+                    return stopping || pending;
+                });
+                // Anything asked for before stopping is still written
+                if (!pending) return;
+
+                snapshot.swap(requested);
+                writing_targets.swap(targets);
+                targets.clear();
+                pending = false;
+                writing = true;
+            }
+
+            for (const Target &target: writing_targets) {
+                ShareWordFormat format = shareword_format_for(target.path.c_str(), target.path.size());
+                buffer.clear();
+                snapshot.serialize(format, &buffer);
+                if (target.autosave) {
+                    if (buffer.bytes == autosaved) continue;
+                    autosaved = buffer.bytes;
+                }
+                write_file_atomically(fs::Path(target.path.c_str()), buffer.bytes.data(), buffer.bytes.size());
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::thread thread;
+    bool stopping = false;
+    bool pending = false;
+    bool writing = false;
+    CrosswordSnapshot requested;
+    std::vector<Target> targets;
+
+    std::chrono::steady_clock::time_point last_autosave = std::chrono::steady_clock::now();
+
+    // Only touched by the worker thread
+    CrosswordSnapshot snapshot;
+    ShareWordBuffer buffer;
+    std::vector<char> autosaved;
+};
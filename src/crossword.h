@@ -0,0 +1,545 @@
+#pragma once
+
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Shapes/Rect.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "./mapped_file.h"
+#include "./shareword_binary.h"
+#include "./shareword_parser.h"
+#include "./shareword_writer.h"
+#include "./slot_table.h"
+#include "./undo_journal.h"
+
+using namespace jovial;
+
+#define PADDING (Window::get_current_width() / 40.0f)
+
+struct Answer {
+    char hint[SHAREWORD_MAX_HINT_LEN + 1] = {0};
+
+    Vector2i coords;
+    int number = 0;
+
+    bool operator<(const Answer &other) const {
+        return number < other.number;
+    }
+};
+
+struct Crossword {
+    Vector2i size;
+    // Owned, size.x * size.y of them
+    char *letters;
+    Vec<Answer> across;
+    Vec<Answer> down;
+    char title[SHAREWORD_MAX_TITLE_LEN + 1];
+    // Kept up to date by set() and erase(), along with the clue numbers
+    SlotTable slots;
+    // Everything edited through set(), erase() and the clue functions; the editor calls
+    // end_step() once a frame, so an undo takes back one frame's edits
+    UndoJournal history;
+
+    explicit Crossword(Vector2i size, const char *title) : size(size), title() {
+        letters = (char *) malloc(sizeof(char) * size.x * size.y);
+        for (int i = 0; i < size.x * size.y; ++i) {
+            letters[i] = '\0';
+        }
+        strncpy(this->title, title, SHAREWORD_MAX_TITLE_LEN);
+        slots.build(size, letters);
+        index_answers();
+    }
+
+    // Crosswords own their letters, so they can be moved but not copied
+    Crossword(const Crossword &) = delete;
+    Crossword &operator=(const Crossword &) = delete;
+
+    Crossword(Crossword &&other) noexcept
+        : size(other.size), letters(other.letters), across(std::move(other.across)), down(std::move(other.down)),
+          slots(std::move(other.slots)), history(std::move(other.history)), across_at(std::move(other.across_at)),
+          down_at(std::move(other.down_at)) {
+        memcpy(title, other.title, sizeof(title));
+        other.letters = nullptr;
+        other.size = {};
+    }
+
+    Crossword &operator=(Crossword &&other) noexcept {
+        if (this == &other) return *this;
+
+        // Whatever was derived from the old slots has to start over, even if the new
+        // table happens to be on the same generation
+        uint32_t generation = slots.generation;
+        std::swap(letters, other.letters);
+        std::swap(size, other.size);
+        memcpy(title, other.title, sizeof(title));
+        across = std::move(other.across);
+        down = std::move(other.down);
+        slots = std::move(other.slots);
+        slots.generation = generation + 1;
+        history = std::move(other.history);
+        across_at = std::move(other.across_at);
+        down_at = std::move(other.down_at);
+        return *this;
+    }
+
+    // Keeps the puzzle as it is if `path` can't be loaded
+    void reconstruct(const fs::Path &path) {
+        Crossword loaded(path);
+        if (loaded.letters == nullptr) return;
+        *this = std::move(loaded);
+    }
+
+    [[nodiscard]] bool contains(Vector2i coord) const {
+        return coord.x >= 0 && coord.y >= 0 && coord.x < size.x && coord.y < size.y;
+    }
+
+    [[nodiscard]] char at(Vector2i coord) const {
+        if (!contains(coord)) {
+            JV_CORE_ERROR("coord ", coord, " is outside the crossword of size ", size);
+            return '\0';
+        }
+
+        return letters[coord.y * size.x + coord.x];
+    }
+
+    void erase(Vector2i coord) {
+        if (!contains(coord)) {
+            JV_CORE_ERROR("coord ", coord, " is outside the crossword of size ", size);
+        } else {
+            for (bool is_across: {true, false}) {
+                int i = find_answer(is_across, coord);
+                if (i != -1) {
+                    remove_answer(is_across, i);
+                }
+            }
+            set(coord, '\0');
+        }
+    }
+
+    void set(Vector2i coord, char c) {
+        if (!contains(coord)) {
+            JV_CORE_ERROR("coord ", coord, " is outside the crossword of size ", size);
+        } else {
+            UndoDelta delta;
+            delta.kind = UndoKind::Cell;
+            delta.index = coord.y * size.x + coord.x;
+            delta.before = letters[delta.index];
+            delta.after = (char) toupper(c);
+            if (delta.before == delta.after) return;
+
+            history.record(delta);
+            write_letter(coord, delta.after);
+        }
+    }
+
+    // The clue starting at `coord`, or -1
+    [[nodiscard]] int find_answer(bool is_across, Vector2i coord) const {
+        if (!contains(coord)) return -1;
+        return (is_across ? across_at : down_at)[coord.y * size.x + coord.x];
+    }
+
+    // The standard number of the word starting at `coord`, or 0 if none does. Numbers the
+    // clues first, see number_answers().
+    [[nodiscard]] int number_at(Vector2i coord) {
+        number_answers();
+        return slots.number(coord);
+    }
+
+    // Gives every clue on a square whose standard number changed since the last call its
+    // new number. Grids are numbered again only from where they changed, but everything
+    // after that moves, so this runs once a step rather than after every set().
+    //
+    // A clue whose square no longer starts a word its way, like after a block cut the word
+    // short, gets number 0 so it can't share a number with another clue. It keeps its hint
+    // and is numbered again once the word is back.
+    void number_answers() {
+        slots.renumber([&](int cell, int number) {
+            Vector2i coord(cell % size.x, cell / size.x);
+            for (bool is_across: {true, false}) {
+                int i = (is_across ? across_at : down_at)[cell];
+                if (i == -1) continue;
+                int wanted = slots.starts_run(is_across, coord) ? number : 0;
+                if ((is_across ? across : down)[i].number != wanted) {
+                    renumber_answer(is_across, i, wanted);
+                }
+            }
+        });
+    }
+
+    // Puts `answer` after the clues with the same or a lower number, leaving the order of
+    // the others as it was. Returns where it went. There should be only one clue per square
+    // and direction, see find_answer().
+    int add_answer(bool is_across, const Answer &answer) {
+        Vec<Answer> &answers = is_across ? across : down;
+        int index = (int) answers.size();
+        while (index > 0 && answer.number < answers[index - 1].number) {
+            index -= 1;
+        }
+
+        UndoDelta delta;
+        delta.kind = UndoKind::Insert;
+        delta.across = is_across;
+        delta.index = index;
+        delta.number = answer.number;
+        delta.coords = answer.coords;
+        memcpy(delta.hint, answer.hint, sizeof(delta.hint));
+        history.record(delta);
+        insert_answer(is_across, index, answer);
+        return index;
+    }
+
+    // Swaps the last clue into its place, like Vec::swap_pop()
+    void remove_answer(bool is_across, int i) {
+        Vec<Answer> &answers = is_across ? across : down;
+        UndoDelta delta;
+        delta.kind = UndoKind::Remove;
+        delta.across = is_across;
+        delta.index = i;
+        delta.number = answers[i].number;
+        delta.coords = answers[i].coords;
+        memcpy(delta.hint, answers[i].hint, sizeof(delta.hint));
+        history.record(delta);
+        swap_pop_answer(is_across, i);
+    }
+
+    void renumber_answer(bool is_across, int i, int number) {
+        Vec<Answer> &answers = is_across ? across : down;
+        UndoDelta delta;
+        delta.kind = UndoKind::Number;
+        delta.across = is_across;
+        delta.index = i;
+        delta.number_before = answers[i].number;
+        delta.number_after = number;
+        history.record(delta);
+        answers[i].number = number;
+        touch_answer(is_across, i);
+    }
+
+    // Changes one character of a hint; '\0' cuts it off there.
+    void set_hint(bool is_across, int i, int position, char c) {
+        if (position < 0 || position >= SHAREWORD_MAX_HINT_LEN) return;
+
+        Answer &answer = (is_across ? across : down)[i];
+        UndoDelta delta;
+        delta.kind = UndoKind::Hint;
+        delta.across = is_across;
+        delta.index = i;
+        delta.position = (uint8_t) position;
+        delta.before = answer.hint[position];
+        delta.after = c;
+        if (delta.before == delta.after) return;
+
+        history.record(delta);
+        answer.hint[position] = c;
+    }
+
+    // Puts both clue lists in number order. Isn't an edit of its own, so the history
+    // starts over.
+    void sort_answers() {
+        across.sort();
+        down.sort();
+        index_answers();
+        history.clear();
+    }
+
+    // Ends the undo step, with the clue numbers its edits moved
+    void end_step() {
+        number_answers();
+        history.mark();
+    }
+
+    // Takes back the newest step of the history. Returns false when there is nothing left
+    // to undo.
+    bool undo() {
+        // Clue numbers are edits in the history too, so they go back with the squares that
+        // changed them
+        number_answers();
+        bool undone = history.undo([&](const UndoDelta &delta, bool forward) {
+            apply(delta, forward);
+        });
+        slots.renumber([](int, int) {});
+        return undone;
+    }
+
+    bool redo() {
+        number_answers();
+        bool redone = history.redo([&](const UndoDelta &delta, bool forward) {
+            apply(delta, forward);
+        });
+        slots.renumber([](int, int) {});
+        return redone;
+    }
+
+    [[nodiscard]] float square_size() const {
+        auto winsize = Window::get_current_size() - Vector2(PADDING * 2);
+        winsize.y -= PADDING;
+        float x = winsize.x / (float) size.x;
+        float y = winsize.y / (float) size.y;
+        return math::min(x, y);
+    }
+
+    [[nodiscard]] Rect2 get_rect() const {
+        return {PADDING, PADDING, (float) size.x * square_size() + PADDING, (float) size.y * square_size() + PADDING};
+    }
+
+    // Picks the format from the file name, see shareword_format_for()
+    void save_to(const fs::Path &path) const {
+        save_to(path, shareword_format_for(path.str.items, path.str.count));
+    }
+
+    void save_to(const fs::Path &path, ShareWordFormat format) const {
+        ShareWordBuffer output;
+        serialize(format, &output);
+        write_file_atomically(path, output.bytes.data(), output.bytes.size());
+    }
+
+    // Binary files keep coordinates in 16 bits and hint offsets in 26, so puzzles past that
+    // are written as text instead
+    void serialize(ShareWordFormat format, ShareWordBuffer *out) const {
+        if (format == ShareWordFormat::Binary) {
+            if (write_shareword_binary(title, size, letters, across, down, out)) return;
+            JV_CORE_ERROR("crossword of size ", size, " is too large for the binary format, writing it as text");
+        }
+        write_shareword_text(title, size, letters, across, down, out);
+    }
+
+    // Leaves `letters` nullptr if the file can't be read or isn't a valid puzzle; `parse`
+    // then says where reading stopped.
+    explicit Crossword(const fs::Path &path, ShareWordParse *parse = nullptr) : letters(nullptr), title() {
+        MappedFile file;
+        if (!file.map(path)) {
+            return;
+        }
+
+        ShareWordParse result;
+        if (ShareWordBinary::detect(file.data, file.size)) {
+            result = load_binary(file.data, file.size);
+        } else {
+            Loader loader{this};
+            result = parse_shareword(file.data, file.size, loader);
+            if (result.ok() && letters == nullptr) {
+                // There was no memory for the grid, whose size is on the second line
+                result.error = ShareWordError::TooLarge;
+                result.line = 2;
+                result.column = 1;
+            }
+        }
+        if (parse != nullptr) {
+            *parse = result;
+        }
+        if (!result.ok()) {
+            JV_CORE_ERROR("could not load ", path.str, ":", result.line, ":", result.column, ": ", shareword_error_text(result.error));
+            free(letters);
+            letters = nullptr;
+            size = {};
+            across.clear();
+            down.clear();
+            return;
+        }
+        slots.build(size, letters);
+        index_answers();
+    }
+
+    ~Crossword() {
+        free(letters);
+    }
+
+private:
+    // Replays an edit from the history, or takes it back, without recording it again
+    void apply(const UndoDelta &delta, bool forward) {
+        Vec<Answer> &answers = delta.across ? across : down;
+        switch (delta.kind) {
+            case UndoKind::Step:
+                break;
+            case UndoKind::Cell:
+                write_letter({(int) delta.index % size.x, (int) delta.index / size.x}, forward ? delta.after : delta.before);
+                break;
+            case UndoKind::Hint:
+                answers[delta.index].hint[delta.position] = forward ? delta.after : delta.before;
+                break;
+            case UndoKind::Number:
+                answers[delta.index].number = forward ? delta.number_after : delta.number_before;
+                touch_answer(delta.across, (int) delta.index);
+                break;
+            case UndoKind::Insert:
+            case UndoKind::Remove: {
+                Answer answer;
+                answer.number = delta.number;
+                answer.coords = delta.coords;
+                memcpy(answer.hint, delta.hint, sizeof(answer.hint));
+                int index = (int) delta.index;
+                if ((delta.kind == UndoKind::Insert) == forward) {
+                    if (delta.kind == UndoKind::Insert) {
+                        insert_answer(delta.across, index, answer);
+                    } else {
+                        // Undoing a swap_pop()
+                        answers.push_back(answer);
+                        std::swap(answers[index], answers[answers.size() - 1]);
+                        index_answer(delta.across, index);
+                        index_answer(delta.across, (int) answers.size() - 1);
+                    }
+                } else if (delta.kind == UndoKind::Insert) {
+                    unindex_answer(delta.across, index);
+                    for (size_t i = index; i + 1 < answers.size(); ++i) {
+                        answers[i] = answers[i + 1];
+                        index_answer(delta.across, (int) i);
+                    }
+                    answers.pop_back();
+                } else {
+                    swap_pop_answer(delta.across, index);
+                }
+            } break;
+        }
+    }
+
+    void write_letter(Vector2i coord, char c) {
+        char &letter = letters[coord.y * size.x + coord.x];
+        bool was_block = letter == '\0';
+        letter = c;
+        if (was_block != (letter == '\0')) {
+            slots.update(letters, coord);
+        } else {
+            slots.touch(coord);
+        }
+    }
+
+    void insert_answer(bool is_across, int index, const Answer &answer) {
+        Vec<Answer> &answers = is_across ? across : down;
+        answers.push_back(answer);
+        for (int i = (int) answers.size() - 1; i > index; --i) {
+            answers[i] = answers[i - 1];
+            index_answer(is_across, i);
+        }
+        answers[index] = answer;
+        index_answer(is_across, index);
+    }
+
+    void swap_pop_answer(bool is_across, int i) {
+        Vec<Answer> &answers = is_across ? across : down;
+        int last = (int) answers.size() - 1;
+        unindex_answer(is_across, i);
+        unindex_answer(is_across, last);
+        answers.swap_pop(i);
+        if (i < last) {
+            index_answer(is_across, i);
+        }
+    }
+
+    void index_answers() {
+        across_at.clear();
+        down_at.clear();
+        for (int i = 0; i < size.x * size.y; ++i) {
+            across_at.push_back(-1);
+            down_at.push_back(-1);
+        }
+        for (size_t i = 0; i < across.size(); ++i) {
+            index_answer(true, (int) i);
+        }
+        for (size_t i = 0; i < down.size(); ++i) {
+            index_answer(false, (int) i);
+        }
+    }
+
+    void index_answer(bool is_across, int i) {
+        Vector2i coord = (is_across ? across : down)[i].coords;
+        if (contains(coord)) {
+            (is_across ? across_at : down_at)[coord.y * size.x + coord.x] = i;
+            slots.tiles.touch(coord);
+        }
+    }
+
+    void unindex_answer(bool is_across, int i) {
+        Vector2i coord = (is_across ? across : down)[i].coords;
+        if (!contains(coord)) return;
+
+        int &at = (is_across ? across_at : down_at)[coord.y * size.x + coord.x];
+        if (at == i) {
+            at = -1;
+            slots.tiles.touch(coord);
+        }
+    }
+
+    // The number of the clue shows on the grid
+    void touch_answer(bool is_across, int i) {
+        Vector2i coord = (is_across ? across : down)[i].coords;
+        if (contains(coord)) {
+            slots.tiles.touch(coord);
+        }
+    }
+
+    // Which clue of each list starts on each square, or -1. A file may have two clues on a
+    // square; then this has the last one.
+    Vec<int> across_at;
+    Vec<int> down_at;
+
+    ShareWordParse load_binary(const char *data, size_t data_size) {
+        ShareWordBinary binary;
+        ShareWordParse result = binary.open(data, data_size);
+        if (!result.ok()) return result;
+
+        strcpy(title, binary.header.title);
+        size = binary.grid_size();
+        letters = (char *) malloc(sizeof(char) * size.x * size.y);
+        if (letters == nullptr) {
+            result.error = ShareWordError::TooLarge;
+            result.column = (int) offsetof(ShareWordHeader, width);
+            return result;
+        }
+        if (!binary.decode_grid(letters)) {
+            result.error = ShareWordError::BadGrid;
+            result.column = (int) binary.header.grid_offset;
+            return result;
+        }
+
+        for (bool is_across: {true, false}) {
+            Vec<Answer> &answers = is_across ? across : down;
+            for (size_t i = 0; i < binary.clue_count(is_across); ++i) {
+                ShareWordClue clue{};
+                if (!binary.clue(is_across, i, &clue)) {
+                    result.error = ShareWordError::BadClue;
+                    result.column = (int) binary.clue_offset(is_across, i);
+                    return result;
+                }
+                Answer answer;
+                answer.number = clue.number;
+                answer.coords = clue.coords;
+                memcpy(answer.hint, clue.hint, clue.len);
+                answers.push_back(answer);
+            }
+        }
+        return result;
+    }
+
+    // Copies what parse_shareword() reads into the crossword
+    struct Loader {
+        Crossword *crossword;
+
+        void title(const char *text, int len) {
+            memcpy(crossword->title, text, len);
+            crossword->title[len] = '\0';
+        }
+
+        void grid(Vector2i size, const char *cells) {
+            crossword->size = size;
+            crossword->letters = (char *) malloc(sizeof(char) * size.x * size.y);
+            // Left null for the constructor to report
+            if (crossword->letters == nullptr) return;
+            for (int i = 0; i < size.x * size.y; ++i) {
+                crossword->letters[i] = cells[i] == '~' ? '\0' : cells[i];
+            }
+        }
+
+        void clue(bool across, int number, Vector2i coords, const char *hint, int len) {
+            Answer answer;
+            answer.number = number;
+            answer.coords = coords;
+            memcpy(answer.hint, hint, len);
+            (across ? crossword->across : crossword->down).push_back(answer);
+        }
+    };
+};
@@ -0,0 +1,330 @@
+#pragma once
+
+#include "Jovial/Components/Components2D.h"
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Renderer/2DRenderer.h"
+#include "Jovial/Renderer/TextRenderer.h"
+#include "Jovial/Shapes/Color.h"
+#include "Jovial/Shapes/Rect.h"
+#include "Jovial/Shapes/ShapeDrawer.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cctype>
+#include <vector>
+
+#include "./crossword.h"
+#include "./font_cache.h"
+#include "./heat_map.h"
+
+using namespace jovial;
+
+inline void draw_number(Vector2 position, int number, Font *font) {
+    String str = to_string(number);
+    for (size_t i = 0; i < str.count; ++i) {
+        int index = str[i] - font->first_char;
+
+        auto padding = (float) font->padding;
+        Rect2 uv = {font->rects[index].x - padding, font->rects[index].y - padding,
+                    font->rects[index].w + padding, font->rects[index].h + padding};
+
+        uv.x /= (float) font->texture.width;
+        uv.y /= (float) font->texture.height;
+        uv.w /= (float) font->texture.width;
+        uv.h /= (float) font->texture.height;
+
+        rendering::TextureDrawProperties props;
+        props.centered = true;
+        props.scale = Vector2(1.0f / 2);
+        props.uv = uv;
+        props.size = {font->size, font->size};
+        props.color = Colors::Black;
+
+        rendering::draw_texture(font->texture, position + Vector2(font->size / 5, font->size / 1.3f), props);
+    }
+}
+
+struct GridShade {
+    Vector2 pos;
+    Color color;
+};
+
+struct GridLetter {
+    Vector2 pos;
+    char letter;
+};
+
+struct GridNumber {
+    Vector2 pos;
+    int number;
+};
+
+// A rectangle of the grid that is all blocks, drawn as one: a whole tile, or a run of
+// blocks in one row of a tile
+struct GridBlocks {
+    Vector2 pos;
+    Vector2 size;
+};
+
+// Everything one frame of the grid draws, by the top left corner of its square. Kept
+// between frames so it stops allocating once it has grown to the grid.
+struct GridFrame {
+    void clear() {
+        blocks.clear();
+        shades.clear();
+        letters.clear();
+        numbers.clear();
+    }
+
+    Vec<GridBlocks> blocks;
+    Vec<GridShade> shades;
+    Vec<GridLetter> letters;
+    Vec<GridNumber> numbers;
+};
+
+// The grid as it was last laid out, a GridFrame per tile of GridTiles. Only the tiles whose
+// stamp moved on since are laid out again; the heat map shades change on their own, so
+// they aren't kept here but laid over it every frame.
+struct GridLayer {
+    std::vector<GridFrame> tiles;
+    std::vector<uint32_t> stamps;
+
+    // What the tiles were laid out for; if any of it changes they all are again
+    uint32_t generation = 0;
+    float square_size = 0;
+    Vector2 origin;
+    bool hidden = false;
+};
+
+struct CrosswordDrawer {
+    CrosswordDrawer() : fonts(JV_FONTS_DIR JV_SEP "jet_brains.ttf") {}
+
+    // Takes this frame's fonts from the cache, which may still be a nearby size while the
+    // window is being resized
+    void update_square_size(const Crossword &crossword) {
+        square_size = crossword.square_size();
+        font = *fonts.get(square_size);
+        hints_font = *fonts.get(square_size / 1.5f);
+        fonts.end_frame();
+    }
+
+    void draw_lines(const Crossword &crossword) {
+        for (int x = 0; x < crossword.size.x + 1; ++x) {
+            rendering::draw_line({Vector2((float) x * square_size + PADDING, PADDING),
+                                  Vector2((float) x * square_size + PADDING, (float) Window::get_current_height() - PADDING * 2)},
+                                 2.0f,
+                                 {.color = Colors::Black});
+        }
+        for (int y = 0; y < crossword.size.y + 1; ++y) {
+            rendering::draw_line({Vector2(PADDING, (float) y * square_size + PADDING),
+                                  Vector2((float) Window::get_current_height() - PADDING * 2, (float) y * square_size + PADDING)},
+                                 2.0f,
+                                 {.color = Colors::Black});
+        }
+        renderer_calls += crossword.size.x + crossword.size.y + 2;
+    }
+
+    // `heat_map` shades the open squares by how few letters still fit there, or leaves them
+    // white when it is nullptr.
+    void draw(const Crossword &crossword, const HeatMap *heat_map = nullptr) {
+        renderer_calls = 0;
+        update_square_size(crossword);
+        draw_lines(crossword);
+
+        font.draw({PADDING, (float) Window::get_current_height() - PADDING * 1.25f},
+                  crossword.title);
+        renderer_calls += 1;
+
+        refresh(crossword, Vector2(PADDING), &layer);
+        overlay.clear();
+        if (heat_map != nullptr) {
+            layout_shades(crossword, *heat_map, Vector2(PADDING), &overlay);
+        }
+        submit(layer, overlay);
+    }
+
+    // Lays out again the tiles of `layer` that changed since it was last brought up to date,
+    // or all of them if the grid, the square size or what is shown changed. Doesn't touch
+    // the renderer.
+    void refresh(const Crossword &crossword, Vector2 origin, GridLayer *layer) {
+        const GridTiles &tiles = crossword.slots.tiles;
+        bool stale = layer->generation != crossword.slots.generation || layer->square_size != square_size ||
+                     layer->origin.x != origin.x || layer->origin.y != origin.y || layer->hidden != hidden ||
+                     layer->tiles.size() != (size_t) tiles.tile_count();
+        if (stale) {
+            layer->tiles.resize(tiles.tile_count());
+            layer->stamps.assign(tiles.tile_count(), 0);
+            layer->generation = crossword.slots.generation;
+            layer->square_size = square_size;
+            layer->origin = origin;
+            layer->hidden = hidden;
+        }
+
+        tiles_laid_out = 0;
+        for (int tile = 0; tile < tiles.tile_count(); ++tile) {
+            if (!stale && layer->stamps[tile] == tiles.stamps[tile]) continue;
+
+            GridFrame &frame = layer->tiles[tile];
+            frame.clear();
+            layout_tile(crossword, tile, origin, &frame);
+            layer->stamps[tile] = tiles.stamps[tile];
+            tiles_laid_out += 1;
+        }
+    }
+
+    // Works out where every square, letter and number of the grid goes in one go, the way
+    // refresh() does for a tile.
+    void layout(const Crossword &crossword, const HeatMap *heat_map, Vector2 origin, GridFrame *out) const {
+        out->clear();
+        for (int tile = 0; tile < crossword.slots.tiles.tile_count(); ++tile) {
+            layout_tile(crossword, tile, origin, out);
+        }
+        if (heat_map != nullptr) {
+            layout_shades(crossword, *heat_map, origin, out);
+        }
+    }
+
+    // Appends the blocks, letters and numbers of one tile. A tile that is all blocks is one
+    // rectangle and its squares aren't looked at.
+    void layout_tile(const Crossword &crossword, int tile, Vector2 origin, GridFrame *out) const {
+        const GridTiles &tiles = crossword.slots.tiles;
+        Vector2i first = tiles.start(tile);
+        Vector2i extent = tiles.extent(tile);
+        if (tiles.all_blocks(tile)) {
+            out->blocks.push_back({square_pos(first, origin), Vector2((float) extent.x * square_size, (float) extent.y * square_size)});
+            return;
+        }
+
+        for (int y = first.y; y < first.y + extent.y; ++y) {
+            int run = 0;
+            for (int x = first.x; x <= first.x + extent.x; ++x) {
+                char letter = x < first.x + extent.x ? crossword.letters[y * crossword.size.x + x] : 'A';
+                if (letter == '\0') {
+                    run += 1;
+                    continue;
+                }
+                if (run > 0) {
+                    out->blocks.push_back({square_pos({x - run, y}, origin), Vector2((float) run * square_size, square_size)});
+                    run = 0;
+                }
+                if (x == first.x + extent.x) break;
+
+                Vector2 pos = square_pos({x, y}, origin);
+                if (!hidden) {
+                    out->letters.push_back({pos, letter});
+                }
+                // A clue numbered 0 lost its word and only shows in the clue list
+                int across = crossword.find_answer(true, {x, y});
+                int down = crossword.find_answer(false, {x, y});
+                int number = across != -1 ? crossword.across[across].number : 0;
+                if (down != -1) {
+                    number = math::max(number, crossword.down[down].number);
+                }
+                if (number != 0) {
+                    out->numbers.push_back({pos, number});
+                }
+            }
+        }
+    }
+
+    void layout_shades(const Crossword &crossword, const HeatMap &heat_map, Vector2 origin, GridFrame *out) const {
+        if (hidden) return;
+
+        const GridTiles &tiles = crossword.slots.tiles;
+        for (int tile = 0; tile < tiles.tile_count(); ++tile) {
+            if (tiles.all_blocks(tile)) continue;
+
+            Vector2i first = tiles.start(tile);
+            Vector2i extent = tiles.extent(tile);
+            for (int y = first.y; y < first.y + extent.y; ++y) {
+                for (int x = first.x; x < first.x + extent.x; ++x) {
+                    char letter = crossword.letters[y * crossword.size.x + x];
+                    if (letter != '\0' && !isalpha((unsigned char) letter)) {
+                        out->shades.push_back({square_pos({x, y}, origin), heat_color(heat_map, crossword, {x, y})});
+                    }
+                }
+            }
+        }
+    }
+
+    // Blocks, then the shades of `overlay`, then letters and numbers on top
+    void submit(const GridLayer &grid, const GridFrame &overlay) {
+        for (const GridFrame &tile: grid.tiles) {
+            submit_blocks(tile);
+        }
+        submit_shades(overlay);
+        for (const GridFrame &tile: grid.tiles) {
+            submit_text(tile);
+        }
+    }
+
+    void submit(const GridFrame &grid) {
+        submit_blocks(grid);
+        submit_shades(grid);
+        submit_text(grid);
+    }
+
+    [[nodiscard]] static Color heat_color(const HeatMap &heat_map, const Crossword &crossword, Vector2i coord) {
+        if (heat_map.dead_at(crossword, coord)) {
+            return Color(0.9f, 0.1f, 0.1f, 0.6f);
+        }
+        int letters = __builtin_popcount(heat_map.letters_at(crossword, coord));
+        return Color(1.0f, 0.55f, 0.0f, 0.5f * (1.0f - (float) letters / DICTIONARY_LETTERS));
+    }
+
+    bool hidden = false;
+    GridLayer layer;
+    GridFrame overlay;
+
+    // Calls into the renderer the last draw() made, and tiles it laid out again. The
+    // renderer has no way to take a batch of quads or lines, so the calls still go up with
+    // the squares shown and the lines of the grid; only the layout is cached.
+    int renderer_calls = 0;
+    int tiles_laid_out = 0;
+
+    float square_size = 0;
+    // Copies of fonts owned by `fonts`, good until the next update_square_size()
+    Font font;
+    Font hints_font;
+    FontCache fonts;
+
+private:
+    [[nodiscard]] Vector2 square_pos(Vector2i coord, Vector2 origin) const {
+        return Vector2((float) coord.x * square_size, (float) coord.y * square_size) + origin;
+    }
+
+    void submit_blocks(const GridFrame &grid) {
+        for (const GridBlocks &blocks: grid.blocks) {
+            rendering::ShapeDrawProperties props{};
+            props.color = Colors::Black;
+            rendering::draw_rect2(Rect2({0.0f, 0.0f}, blocks.size).move(blocks.pos), props);
+        }
+        renderer_calls += (int) grid.blocks.size();
+    }
+
+    void submit_shades(const GridFrame &grid) {
+        Rect2 base_square({0.0f, 0.0f}, {square_size, square_size});
+        for (const GridShade &shade: grid.shades) {
+            rendering::ShapeDrawProperties props{};
+            props.color = shade.color;
+            rendering::draw_rect2(base_square.move(shade.pos), props);
+        }
+        renderer_calls += (int) grid.shades.size();
+    }
+
+    void submit_text(const GridFrame &grid) {
+        for (const GridLetter &letter: grid.letters) {
+            draw_char(letter.pos, letter.letter, &font);
+        }
+        for (const GridNumber &number: grid.numbers) {
+            draw_number(number.pos, number.number, &font);
+            // A texture a digit
+            int digits = 1;
+            for (int n = number.number / 10; n != 0; n /= 10) {
+                digits += 1;
+            }
+            renderer_calls += digits;
+        }
+        renderer_calls += (int) grid.letters.size();
+    }
+};
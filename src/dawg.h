@@ -0,0 +1,284 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./pattern.h"
+
+using namespace jovial;
+
+// Both structs are written to compiled dictionaries as-is, so they have no implicit padding
+struct DawgEdge {
+    char letter = 0;
+    uint8_t padding[3] = {};
+    uint32_t target = 0;
+};
+static_assert(sizeof(DawgEdge) == 8);
+
+struct DawgNode {
+    uint32_t first_edge = 0;
+    uint16_t edge_count = 0;
+    bool terminal = false;
+    uint8_t max_len = 0;// longest suffix reachable from this node
+    uint32_t count = 0; // words in the sub-graph, including this node if terminal
+};
+static_assert(sizeof(DawgNode) == 12);
+
+// Minimal acyclic automaton over a sorted word list. Every word gets the id of its
+// position in that list, recovered from the per-node word counts while walking, so all
+// words below a node form one contiguous id range.
+struct Dawg {
+    // `word_at(i)` must return the words sorted and unique, and `letter(word, i)` their i-th byte.
+    template<typename WordAt, typename LetterFn>
+    void build(size_t word_count, WordAt &&word_at, LetterFn &&letter) {
+        Builder builder;
+        for (size_t i = 0; i < word_count; ++i) {
+            builder.insert(word_at(i), letter);
+        }
+        builder.minimize(0);
+        freeze(builder);
+    }
+
+    // Uses nodes and edges that live elsewhere, such as in a mapped compiled dictionary.
+    void attach(const DawgNode *attached_nodes, uint32_t attached_node_count,
+                const DawgEdge *attached_edges, uint32_t attached_edge_count) {
+        owned_nodes.clear();
+        owned_edges.clear();
+        nodes = attached_nodes;
+        node_count = attached_node_count;
+        edges = attached_edges;
+        edge_count = attached_edge_count;
+    }
+
+    // Whether attached nodes and edges are safe to walk: every edge inside the edge array and
+    // pointing at a node, and every count the sum of its node's own word and its children's,
+    // with `word_count` at the root, so that no id range reaches past the last word.
+    [[nodiscard]] bool is_consistent(uint32_t word_count) const {
+        if (node_count == 0) return edge_count == 0;
+        if (nodes[0].count != word_count) return false;
+        for (uint32_t n = 0; n < node_count; ++n) {
+            const DawgNode &node = nodes[n];
+            if ((uint64_t) node.first_edge + node.edge_count > edge_count) return false;
+            uint64_t count = node.terminal ? 1 : 0;
+            for (uint32_t e = node.first_edge; e < node.first_edge + node.edge_count; ++e) {
+                if (edges[e].target >= node_count) return false;
+                count += nodes[edges[e].target].count;
+            }
+            if (count != node.count) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool is_empty() const {
+        return node_count == 0;
+    }
+
+    // Calls on_range(first_id, end_id) for every run of word ids matching the pattern until
+    // it returns false. The words must have been built folded to lower case.
+    template<typename F>
+    bool query(const CompiledPattern &pattern, F &&on_range) const {
+        if (is_empty() || pattern.len <= 0) return true;
+        int fixed_len = pattern.open_ended ? pattern.len - 1 : pattern.len;
+        return walk(0, 0, 0, pattern, fixed_len, on_range);
+    }
+
+    // Id range of every word starting with `prefix`, including the prefix itself. Returns
+    // false when no word does.
+    bool prefix_range(const char *prefix, int prefix_len, uint32_t *first, uint32_t *end) const {
+        if (is_empty()) return false;
+
+        uint32_t node_id = 0;
+        uint32_t base = 0;
+        for (int i = 0; i < prefix_len; ++i) {
+            const DawgNode &node = nodes[node_id];
+            uint32_t child_base = base + (node.terminal ? 1 : 0);
+            bool found = false;
+            for (uint32_t e = node.first_edge; e < node.first_edge + node.edge_count; ++e) {
+                if (edges[e].letter == prefix[i]) {
+                    node_id = edges[e].target;
+                    found = true;
+                    break;
+                }
+                child_base += nodes[edges[e].target].count;
+            }
+            if (!found) return false;
+            base = child_base;
+        }
+
+        *first = base;
+        *end = base + nodes[node_id].count;
+        return true;
+    }
+
+    const DawgNode *nodes = nullptr;
+    uint32_t node_count = 0;
+    const DawgEdge *edges = nullptr;
+    uint32_t edge_count = 0;
+
+private:
+    Vec<DawgNode> owned_nodes;
+    Vec<DawgEdge> owned_edges;
+
+    struct BuildNode {
+        bool terminal = false;
+        std::vector<std::pair<char, uint32_t>> edges;
+    };
+
+    struct Builder {
+        Builder() {
+            nodes.emplace_back();
+        }
+
+        template<typename Word, typename LetterFn>
+        void insert(const Word &word, LetterFn &&letter) {
+            size_t len = word.size();
+            size_t common = 0;
+            while (common < len && common < previous.size() && letter(word, common) == previous[common]) {
+                common += 1;
+            }
+
+            minimize(common);
+
+            uint32_t node = unchecked.empty() ? 0 : unchecked.back().child;
+            for (size_t i = common; i < len; ++i) {
+                auto child = (uint32_t) nodes.size();
+                nodes.emplace_back();
+                nodes[node].edges.emplace_back(letter(word, i), child);
+                unchecked.push_back({node, child});
+                node = child;
+            }
+            nodes[node].terminal = true;
+
+            previous.resize(len);
+            for (size_t i = 0; i < len; ++i) {
+                previous[i] = letter(word, i);
+            }
+        }
+
+        // Merges every unchecked node deeper than `depth` with an equivalent registered node.
+        void minimize(size_t depth) {
+            while (unchecked.size() > depth) {
+                Unchecked entry = unchecked.back();
+                unchecked.pop_back();
+
+                std::string key = signature(entry.child);
+                auto found = registry.find(key);
+                if (found != registry.end()) {
+                    nodes[entry.parent].edges.back().second = found->second;
+                } else {
+                    registry.emplace(std::move(key), entry.child);
+                }
+            }
+        }
+
+        [[nodiscard]] std::string signature(uint32_t node) const {
+            std::string key;
+            key += nodes[node].terminal ? '1' : '0';
+            for (auto &edge: nodes[node].edges) {
+                key += edge.first;
+                key.append((const char *) &edge.second, sizeof(edge.second));
+            }
+            return key;
+        }
+
+        struct Unchecked {
+            uint32_t parent;
+            uint32_t child;
+        };
+
+        std::vector<BuildNode> nodes;
+        std::vector<Unchecked> unchecked;
+        std::unordered_map<std::string, uint32_t> registry;
+        std::string previous;
+    };
+
+    void freeze(const Builder &builder) {
+        owned_nodes.clear();
+        owned_edges.clear();
+
+        // Nodes that were merged away are unreachable, so only the reachable ones are copied.
+        std::vector<uint32_t> remap(builder.nodes.size(), UINT32_MAX);
+        std::vector<uint32_t> order;
+        order.push_back(0);
+        remap[0] = 0;
+        for (size_t i = 0; i < order.size(); ++i) {
+            for (auto &edge: builder.nodes[order[i]].edges) {
+                if (remap[edge.second] == UINT32_MAX) {
+                    remap[edge.second] = (uint32_t) order.size();
+                    order.push_back(edge.second);
+                }
+            }
+        }
+
+        for (uint32_t old_id: order) {
+            const BuildNode &old = builder.nodes[old_id];
+            DawgNode node;
+            node.first_edge = (uint32_t) owned_edges.size();
+            node.edge_count = (uint16_t) old.edges.size();
+            node.terminal = old.terminal;
+            owned_nodes.push_back(node);
+            for (auto &old_edge: old.edges) {
+                DawgEdge edge;
+                edge.letter = old_edge.first;
+                edge.target = remap[old_edge.second];
+                owned_edges.push_back(edge);
+            }
+        }
+
+        std::vector<bool> done(owned_nodes.size(), false);
+        summarize(0, done);
+
+        nodes = &owned_nodes[0];
+        node_count = (uint32_t) owned_nodes.size();
+        edges = owned_edges.size() > 0 ? &owned_edges[0] : nullptr;
+        edge_count = (uint32_t) owned_edges.size();
+    }
+
+    // Post-order, since a shared suffix node can be reached from parents at any depth.
+    void summarize(uint32_t node_id, std::vector<bool> &done) {
+        if (done[node_id]) return;
+        done[node_id] = true;
+
+        DawgNode &node = owned_nodes[node_id];
+        node.count = node.terminal ? 1 : 0;
+        for (uint32_t e = node.first_edge; e < node.first_edge + node.edge_count; ++e) {
+            summarize(owned_edges[e].target, done);
+            const DawgNode &child = owned_nodes[owned_edges[e].target];
+            node.count += child.count;
+            node.max_len = (uint8_t) math::min(math::max((int) node.max_len, child.max_len + 1), UINT8_MAX);
+        }
+    }
+
+    template<typename F>
+    bool walk(uint32_t node_id, int depth, uint32_t base, const CompiledPattern &pattern, int fixed_len, F &&on_range) const {
+        const DawgNode &node = nodes[node_id];
+
+        if (depth == fixed_len) {
+            if (pattern.open_ended) {
+                uint32_t first = base + (node.terminal ? 1 : 0);
+                return first == base + node.count || on_range(first, base + node.count);
+            }
+            return !node.terminal || on_range(base, base + 1);
+        }
+
+        int remaining = fixed_len - depth + (pattern.open_ended ? 1 : 0);
+
+        uint32_t child_base = base + (node.terminal ? 1 : 0);
+        for (uint32_t e = node.first_edge; e < node.first_edge + node.edge_count; ++e) {
+            const DawgEdge &edge = edges[e];
+            const DawgNode &child = nodes[edge.target];
+
+            if (pattern.allows(depth, edge.letter) && child.max_len + 1 >= remaining) {
+                if (!walk(edge.target, depth + 1, child_base, pattern, fixed_len, on_range)) {
+                    return false;
+                }
+            }
+            child_base += child.count;
+        }
+        return true;
+    }
+};
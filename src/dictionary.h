@@ -0,0 +1,567 @@
+#pragma once
+
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "./dawg.h"
+#include "./mapped_file.h"
+#include "./match_kernel.h"
+#include "./pattern.h"
+
+using namespace jovial;
+
+// Words longer than this only live in the DAWG
+#define DICTIONARY_MAX_WORD_LEN 32
+#define DICTIONARY_MAX_PATTERN_LEN PATTERN_MAX_LEN
+#define DICTIONARY_LETTERS 26
+
+#define COMPILED_DICTIONARY_MAGIC "SWDICT"
+#define COMPILED_DICTIONARY_VERSION 3
+
+[[nodiscard]] inline int letter_index(char c) {
+    c = (char) tolower(c);
+    if (c < 'a' || c > 'z') return -1;
+    return c - 'a';
+}
+
+[[nodiscard]] inline bool is_wildcard(char c) {
+    return c == '_' || c == '*';
+}
+
+// How easy a word is to cross: common letters score high and J, Q, X or Z low. It is averaged
+// per letter so that short and long words rank on the same scale.
+[[nodiscard]] inline uint16_t fill_score(StringView word) {
+    // English letter frequencies in tenths of a percent
+    static const uint8_t weights[DICTIONARY_LETTERS] = {
+            82, 15, 28, 43, 127, 22, 20, 61, 70, 2, 8, 40, 24,
+            67, 75, 19, 1, 60, 63, 91, 28, 10, 24, 2, 20, 1,
+    };
+
+    if (word.size() == 0) return 0;
+    uint32_t total = 0;
+    for (size_t i = 0; i < word.size(); ++i) {
+        int letter = letter_index(word[i]);
+        if (letter != -1) {
+            total += weights[letter];
+        }
+    }
+    return (uint16_t) (total * 16 / word.size());
+}
+
+struct WordSpan {
+    uint32_t offset = 0;
+    uint32_t len = 0;
+};
+
+// Ids of all words of one length, plus a bitset per (position, letter) saying which of
+// them have that letter at that position. The folded words are also kept as fixed-width
+// rows for the masked compare kernels. The arrays either live in `storage` or in a mapped
+// compiled dictionary.
+struct LengthBucket {
+    [[nodiscard]] const uint64_t *posting(int position, int letter) const {
+        return postings + ((size_t) position * DICTIONARY_LETTERS + letter) * blocks;
+    }
+
+    // Which words of one 64-word block have a character from `mask` at `position`. Non-letters
+    // have no posting list, so a mask that allows them is answered as "none of the letters it
+    // leaves out", which may set bits past the last word.
+    [[nodiscard]] uint64_t allowed(int position, uint32_t mask, size_t block) const {
+        bool others = (mask & PATTERN_OTHER_BIT) != 0;
+        uint64_t bits = 0;
+        for (uint32_t letters = others ? ~mask & PATTERN_LETTERS : mask; letters != 0; letters &= letters - 1) {
+            bits |= posting(position, __builtin_ctz(letters))[block];
+        }
+        return others ? ~bits : bits;
+    }
+
+    // The bits of `block` that stand for actual words.
+    [[nodiscard]] uint64_t valid(size_t block) const {
+        size_t remaining = count - block * 64;
+        return remaining < 64 ? ((uint64_t) 1 << remaining) - 1 : ~(uint64_t) 0;
+    }
+
+    [[nodiscard]] size_t postings_size() const {
+        return (size_t) len * DICTIONARY_LETTERS * blocks * sizeof(uint64_t);
+    }
+
+    void allocate(int word_len, uint32_t word_count) {
+        free(storage);
+        len = word_len;
+        count = 0;
+        blocks = (word_count + 63) / 64;
+        stride = match_stride(len);
+
+        size_t ids_size = word_count * sizeof(uint32_t);
+        storage = calloc(1, postings_size() + ids_size + (size_t) word_count * stride + 1);
+        postings = (uint64_t *) storage;
+        ids = (uint32_t *) ((char *) storage + postings_size());
+        rows = (uint8_t *) ((char *) ids + ids_size);
+    }
+
+    void attach(int word_len, uint32_t word_count, const char *base, uint64_t ids_offset, uint64_t postings_offset, uint64_t rows_offset) {
+        free(storage);
+        storage = nullptr;
+        len = word_len;
+        count = word_count;
+        blocks = (word_count + 63) / 64;
+        stride = match_stride(len);
+        ids = (const uint32_t *) (base + ids_offset);
+        postings = (const uint64_t *) (base + postings_offset);
+        rows = (const uint8_t *) (base + rows_offset);
+    }
+
+    // Only used while building in memory, where the arrays are owned.
+    void add(uint32_t id, StringView word) {
+        auto *bits = (uint64_t *) postings;
+        auto *row = (uint8_t *) rows + (size_t) count * stride;
+        for (int p = 0; p < len; ++p) {
+            row[p] = (uint8_t) tolower(word[p]);
+            int letter = letter_index(word[p]);
+            if (letter != -1) {
+                bits[((size_t) p * DICTIONARY_LETTERS + letter) * blocks + count / 64] |= (uint64_t) 1 << (count % 64);
+            }
+        }
+        ((uint32_t *) ids)[count] = id;
+        count += 1;
+    }
+
+    LengthBucket() = default;
+    LengthBucket(const LengthBucket &) = delete;
+    LengthBucket &operator=(const LengthBucket &) = delete;
+
+    ~LengthBucket() {
+        free(storage);
+    }
+
+    int len = 0;
+    uint32_t count = 0;
+    size_t blocks = 0;
+    int stride = 0;
+    const uint32_t *ids = nullptr;
+    const uint64_t *postings = nullptr;
+    const uint8_t *rows = nullptr;
+    void *storage = nullptr;
+};
+
+// Layout of a compiled dictionary: this header, then 64-byte aligned sections at the given
+// file offsets, all in native byte order so the file can be used straight from the mapping.
+struct CompiledBucket {
+    uint32_t count = 0;
+    uint32_t padding = 0;
+    uint64_t ids = 0;
+    uint64_t postings = 0;
+    uint64_t rows = 0;
+};
+
+struct CompiledDictionaryHeader {
+    char magic[8] = {};
+    uint32_t version = 0;
+    uint32_t word_count = 0;
+    FileStamp source;
+
+    uint64_t spans = 0;
+    uint64_t text = 0;
+    uint64_t text_size = 0;
+    uint64_t scores = 0;
+
+    uint64_t nodes = 0;
+    uint64_t edges = 0;
+    uint32_t node_count = 0;
+    uint32_t edge_count = 0;
+
+    CompiledBucket buckets[DICTIONARY_MAX_WORD_LEN + 1];
+};
+
+struct Dictionary {
+    Dictionary() = default;
+    Dictionary(const Dictionary &) = delete;
+    Dictionary &operator=(const Dictionary &) = delete;
+
+    // Only maps the word list. The index is built by build_index(), either directly or on a
+    // background thread through index_in_background(), and queries find nothing until then.
+    bool open(const fs::Path &path) {
+        return file.map(path);
+    }
+
+    void load(const fs::Path &path) {
+        if (open(path)) {
+            build_index();
+        }
+    }
+
+    // Uses a dictionary written by save_compiled() as-is. Fails, leaving the dictionary
+    // closed, when the file is damaged, from another version, or older than `source`.
+    bool open_compiled(const fs::Path &path, const fs::Path &source) {
+        // The compiled file is optional, so a missing one isn't worth an error
+        FileStamp compiled_stamp;
+        if (!FileStamp::of(path, &compiled_stamp)) return false;
+        if (!file.map(path)) return false;
+
+        const char *base = file.data;
+        const auto *header = (const CompiledDictionaryHeader *) base;
+        if (file.size < sizeof(CompiledDictionaryHeader) ||
+            strncmp(header->magic, COMPILED_DICTIONARY_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != COMPILED_DICTIONARY_VERSION) {
+            JV_CORE_ERROR("not a compiled dictionary: ", path.str);
+            file.unmap();
+            return false;
+        }
+
+        FileStamp stamp;
+        if (FileStamp::of(source, &stamp) && !(stamp == header->source)) {
+            printj("Compiled dictionary ", path.str, " is out of date, using ", source.str);
+            file.unmap();
+            return false;
+        }
+
+        bool fits = fits_in_file(header->spans, header->word_count * sizeof(WordSpan)) &&
+                    fits_in_file(header->text, header->text_size) &&
+                    fits_in_file(header->scores, header->word_count * sizeof(uint16_t)) &&
+                    fits_in_file(header->nodes, header->node_count * sizeof(DawgNode)) &&
+                    fits_in_file(header->edges, header->edge_count * sizeof(DawgEdge));
+        for (int len = 1; len <= DICTIONARY_MAX_WORD_LEN && fits; ++len) {
+            const CompiledBucket &compiled = header->buckets[len];
+            size_t blocks = ((size_t) compiled.count + 63) / 64;
+            fits = fits_in_file(compiled.ids, compiled.count * sizeof(uint32_t)) &&
+                   fits_in_file(compiled.postings, (size_t) len * DICTIONARY_LETTERS * blocks * sizeof(uint64_t)) &&
+                   fits_in_file(compiled.rows, (size_t) compiled.count * match_stride(len));
+        }
+        if (!fits) {
+            JV_CORE_ERROR("compiled dictionary is truncated: ", path.str);
+            file.unmap();
+            return false;
+        }
+
+        // The sections are read without bounds checks later, so every index in them has to
+        // point inside the section it indexes
+        const auto *compiled_spans = (const WordSpan *) (base + header->spans);
+        bool consistent = true;
+        for (uint32_t id = 0; id < header->word_count && consistent; ++id) {
+            consistent = (uint64_t) compiled_spans[id].offset + compiled_spans[id].len <= header->text_size;
+        }
+        for (int len = 1; len <= DICTIONARY_MAX_WORD_LEN && consistent; ++len) {
+            const CompiledBucket &compiled = header->buckets[len];
+            const auto *ids = (const uint32_t *) (base + compiled.ids);
+            for (uint32_t i = 0; i < compiled.count && consistent; ++i) {
+                consistent = ids[i] < header->word_count;
+            }
+        }
+        Dawg compiled_dawg;
+        compiled_dawg.attach((const DawgNode *) (base + header->nodes), header->node_count,
+                             (const DawgEdge *) (base + header->edges), header->edge_count);
+        if (!consistent || !compiled_dawg.is_consistent(header->word_count)) {
+            JV_CORE_ERROR("compiled dictionary is damaged: ", path.str);
+            file.unmap();
+            return false;
+        }
+
+        // Only attached once every section is known to be inside the mapping
+        for (int len = 1; len <= DICTIONARY_MAX_WORD_LEN; ++len) {
+            const CompiledBucket &compiled = header->buckets[len];
+            buckets[len].attach(len, compiled.count, base, compiled.ids, compiled.postings, compiled.rows);
+        }
+
+        owned_spans.clear();
+        owned_scores.clear();
+        spans = compiled_spans;
+        word_base = base + header->text;
+        scores = (const uint16_t *) (base + header->scores);
+        word_count = header->word_count;
+        dawg.attach((const DawgNode *) (base + header->nodes), header->node_count,
+                    (const DawgEdge *) (base + header->edges), header->edge_count);
+
+        indexing_started = true;
+        ready.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Writes the built index, so that open_compiled() needs no parsing. The words keep the
+    // spelling of the list, as word() returns them from it; the bucket rows and the DAWG are
+    // folded already. The file is put together in memory and written atomically, so an
+    // interrupted or failed save never leaves a file with the header but not the sections.
+    bool save_compiled(const fs::Path &path, const FileStamp &source) const {
+        Vec<WordSpan> word_spans;
+        Vec<char> text;
+        for (uint32_t id = 0; id < word_count; ++id) {
+            StringView w = word(id);
+            word_spans.push_back({(uint32_t) text.size(), (uint32_t) w.size()});
+            for (size_t i = 0; i < w.size(); ++i) {
+                text.push_back(w[i]);
+            }
+        }
+
+        CompiledDictionaryHeader header;
+        strncpy(header.magic, COMPILED_DICTIONARY_MAGIC, sizeof(header.magic));
+        header.version = COMPILED_DICTIONARY_VERSION;
+        header.word_count = word_count;
+        header.source = source;
+
+        std::vector<char> output(sizeof(header));
+        auto section = [&](const void *data, size_t bytes) {
+            output.resize((output.size() + 63) / 64 * 64);
+            uint64_t offset = output.size();
+            output.insert(output.end(), (const char *) data, (const char *) data + bytes);
+            return offset;
+        };
+
+        header.spans = section(word_count > 0 ? &word_spans[0] : nullptr, word_count * sizeof(WordSpan));
+        header.text = section(text.size() > 0 ? &text[0] : nullptr, text.size());
+        header.text_size = text.size();
+        header.scores = section(scores, word_count * sizeof(uint16_t));
+        header.nodes = section(dawg.nodes, dawg.node_count * sizeof(DawgNode));
+        header.node_count = dawg.node_count;
+        header.edges = section(dawg.edges, dawg.edge_count * sizeof(DawgEdge));
+        header.edge_count = dawg.edge_count;
+
+        for (int len = 1; len <= DICTIONARY_MAX_WORD_LEN; ++len) {
+            const LengthBucket &bucket = buckets[len];
+            CompiledBucket &compiled = header.buckets[len];
+            compiled.count = bucket.count;
+            compiled.ids = section(bucket.ids, bucket.count * sizeof(uint32_t));
+            compiled.postings = section(bucket.postings, bucket.postings_size());
+            compiled.rows = section(bucket.rows, (size_t) bucket.count * bucket.stride);
+        }
+
+        memcpy(output.data(), &header, sizeof(header));
+        return write_file_atomically(path, output.data(), output.size());
+    }
+
+    void index_in_background() {
+        if (indexing_started) return;
+        indexing_started = true;
+        indexer = std::thread([this] { build_index(); });
+    }
+
+    [[nodiscard]] bool is_ready() const {
+        return ready.load(std::memory_order_acquire);
+    }
+
+    void build_index() {
+        Vec<StringView> lines;
+        for_each_line([&](StringView word) {
+            lines.push_back(word);
+        });
+
+        // Word ids are positions in folded order, which is also the order the DAWG numbers them in
+        std::sort(lines.begin(), lines.end(), [](StringView a, StringView b) {
+            return compare_folded(a, b) < 0;
+        });
+        owned_spans.clear();
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (i == 0 || compare_folded(lines[i - 1], lines[i]) != 0) {
+                owned_spans.push_back({(uint32_t) lines[i].begin, (uint32_t) lines[i].size()});
+            }
+        }
+        spans = owned_spans.size() > 0 ? &owned_spans[0] : nullptr;
+        word_base = file.data;
+        word_count = (uint32_t) owned_spans.size();
+
+        owned_scores.clear();
+        for (uint32_t id = 0; id < word_count; ++id) {
+            owned_scores.push_back(fill_score(word(id)));
+        }
+        scores = word_count > 0 ? &owned_scores[0] : nullptr;
+
+        uint32_t counts[DICTIONARY_MAX_WORD_LEN + 1] = {};
+        for (uint32_t id = 0; id < word_count; ++id) {
+            if (spans[id].len <= DICTIONARY_MAX_WORD_LEN) {
+                counts[spans[id].len] += 1;
+            }
+        }
+        for (int len = 1; len <= DICTIONARY_MAX_WORD_LEN; ++len) {
+            buckets[len].allocate(len, counts[len]);
+        }
+        for (uint32_t id = 0; id < word_count; ++id) {
+            if (spans[id].len <= DICTIONARY_MAX_WORD_LEN) {
+                buckets[spans[id].len].add(id, word(id));
+            }
+        }
+
+        dawg.build(word_count, [&](size_t id) { return word((uint32_t) id); }, [](StringView word, size_t i) {
+            return (char) tolower(word[i]);
+        });
+
+#ifdef __GLIBC__
+        // The DAWG builder frees millions of small nodes; merging them here keeps that cost
+        // off whichever allocation happens to come next, usually the first keystroke
+        malloc_trim(0);
+#endif
+        ready.store(true, std::memory_order_release);
+    }
+
+    ~Dictionary() {
+        if (indexer.joinable()) {
+            indexer.join();
+        }
+    }
+
+    [[nodiscard]] StringView word(uint32_t id) const {
+        return {(char *) word_base, spans[id].offset, spans[id].offset + spans[id].len};
+    }
+
+    // Calls on_match(StringView) for every word matching the pattern until it returns false.
+    // '_' matches any single character, and a trailing '*' also allows any non-empty suffix.
+    template<typename F>
+    void query(const char *pattern, int pattern_len, F &&on_match) const {
+        if (pattern_len <= 0 || pattern_len > DICTIONARY_MAX_PATTERN_LEN) return;
+        query(CompiledPattern::simple(pattern, pattern_len), on_match);
+    }
+
+    // Same for a compiled pattern, whose positions may also be classes of letters.
+    template<typename F>
+    void query(const CompiledPattern &pattern, F &&on_match) const {
+        if (!is_ready() || pattern.len <= 0) return;
+
+        // Fixed-length patterns that don't start with a literal would make the DAWG visit
+        // most prefixes, so those go through the positional bitsets instead.
+        if (!pattern.open_ended && pattern.literals[0] == 0 && pattern.len <= DICTIONARY_MAX_WORD_LEN) {
+            query_bucket(buckets[pattern.len], pattern, on_match);
+            return;
+        }
+
+        dawg.query(pattern, [&](uint32_t first, uint32_t end) {
+            for (uint32_t id = first; id < end; ++id) {
+                if (!on_match(word(id))) return false;
+            }
+            return true;
+        });
+    }
+
+    [[nodiscard]] static int compare_folded(StringView a, StringView b) {
+        size_t len = math::min(a.size(), b.size());
+        for (size_t i = 0; i < len; ++i) {
+            int diff = tolower(a[i]) - tolower(b[i]);
+            if (diff != 0) return diff;
+        }
+        return (int) a.size() - (int) b.size();
+    }
+
+    MappedFile file;// the word list, or a compiled dictionary
+
+    const WordSpan *spans = nullptr;
+    const char *word_base = nullptr;
+    const uint16_t *scores = nullptr;// fill_score() of every word
+    uint32_t word_count = 0;
+
+    LengthBucket buckets[DICTIONARY_MAX_WORD_LEN + 1];
+    Dawg dawg;
+
+private:
+    Vec<WordSpan> owned_spans;
+    Vec<uint16_t> owned_scores;
+
+    bool indexing_started = false;
+    std::atomic<bool> ready = false;
+    std::thread indexer;
+
+    [[nodiscard]] bool fits_in_file(uint64_t offset, uint64_t bytes) const {
+        return offset <= file.size && bytes <= file.size - offset;
+    }
+
+    template<typename F>
+    void for_each_line(F &&f) const {
+        StringView view = file.view();
+        while (view.size() > 0) {
+            StringView line = view.chop_to('\n');
+            view.begin += line.size();
+            if (view.size() > 0) view.begin += 1;
+
+            line.trim_lead();
+            while (line.size() > 0 && isspace(line[line.size() - 1])) {
+                line.end -= 1;
+            }
+            if (line.size() > 0) {
+                f(line);
+            }
+        }
+    }
+
+    // Intersects the posting bitsets of every constrained position in the pattern, where a
+    // class is the union of the bitsets of its letters. A literal that isn't a letter can't be
+    // told apart from other non-letters that way, so those patterns run through the masked
+    // compare kernel over the bucket's rows instead.
+    template<typename F>
+    bool query_bucket(const LengthBucket &bucket, const CompiledPattern &pattern, F &&on_match) const {
+        if (bucket.count == 0) return true;
+
+        int positions[DICTIONARY_MAX_WORD_LEN];
+        int position_count = 0;
+        for (int p = 0; p < pattern.len && p < bucket.len; ++p) {
+            if (pattern.is_any(p)) continue;
+            if (pattern.literals[p] != 0 && !pattern.letters_only(p)) {
+                return query_rows(bucket, pattern, on_match);
+            }
+            positions[position_count++] = p;
+        }
+
+        for (size_t block = 0; block < bucket.blocks; ++block) {
+            uint64_t bits = bucket.valid(block);
+            for (int i = 0; i < position_count && bits != 0; ++i) {
+                bits &= bucket.allowed(positions[i], pattern.masks[positions[i]], block);
+            }
+
+            if (!emit_block(bucket, block, bits, on_match)) return false;
+        }
+        return true;
+    }
+
+    // The kernel compares the single-character positions; classes are then checked on the
+    // rows it let through.
+    template<typename F>
+    bool query_rows(const LengthBucket &bucket, const CompiledPattern &pattern, F &&on_match) const {
+        uint8_t value[32] = {}, mask[32] = {};
+        int classes[DICTIONARY_MAX_WORD_LEN];
+        int class_count = 0;
+        for (int p = 0; p < pattern.len && p < bucket.len; ++p) {
+            if (pattern.literals[p] != 0) {
+                value[p] = (uint8_t) pattern.literals[p];
+                mask[p] = 0xFF;
+            } else if (!pattern.is_any(p)) {
+                classes[class_count++] = p;
+            }
+        }
+
+        auto *hits = (uint64_t *) malloc(bucket.blocks * sizeof(uint64_t));
+        best_match_kernel()(bucket.rows, bucket.count, bucket.stride, value, mask, hits);
+
+        bool more = true;
+        for (size_t block = 0; block < bucket.blocks && more; ++block) {
+            uint64_t bits = hits[block];
+            for (uint64_t rest = bits; rest != 0; rest &= rest - 1) {
+                size_t index = block * 64 + __builtin_ctzll(rest);
+                const uint8_t *row = bucket.rows + index * bucket.stride;
+                for (int i = 0; i < class_count; ++i) {
+                    if (!pattern.allows(classes[i], (char) row[classes[i]])) {
+                        bits &= ~((uint64_t) 1 << (index % 64));
+                        break;
+                    }
+                }
+            }
+            more = emit_block(bucket, block, bits, on_match);
+        }
+        free(hits);
+        return more;
+    }
+
+    template<typename F>
+    bool emit_block(const LengthBucket &bucket, size_t block, uint64_t bits, F &&on_match) const {
+        while (bits != 0) {
+            size_t index = block * 64 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (!on_match(word(bucket.ids[index]))) return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Renderer/TextRenderer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace jovial;
+
+// Fonts kept baked at once
+#define FONT_CACHE_SIZE 6
+// Frames in a row a size has to be asked for before it is baked
+#define FONT_CACHE_SETTLE_FRAMES 10
+
+// One TTF baked at the sizes it is drawn at, rounded to whole pixels. Resizing the window
+// asks for a new size every frame, so rather than baking each of them the nearest font
+// already baked is handed out until a size has been asked for FONT_CACHE_SETTLE_FRAMES
+// frames in a row, or the nearest is more than a third off. Once FONT_CACHE_SIZE fonts
+// are baked the least recently used one is destroyed to make room.
+struct FontCache {
+    explicit FontCache(const char *path) {
+        data = fs::read_file_data(path, &data_len);
+    }
+
+    FontCache(const FontCache &) = delete;
+    FontCache &operator=(const FontCache &) = delete;
+
+    ~FontCache() {
+        for (Entry &entry: entries) {
+            if (entry.pixels != 0) {
+                destroy_font(&entry.font);
+            }
+        }
+    }
+
+    // The font to draw text `size` pixels high with this frame
+    Font *get(float size) {
+        int pixels = math::max(1, (int) std::lround(size));
+        clock += 1;
+
+        Request *request = nullptr;
+        for (int i = 0; i < request_count; ++i) {
+            if (requests[i].pixels == pixels) {
+                request = &requests[i];
+            }
+        }
+        if (request == nullptr && request_count < FONT_CACHE_SIZE) {
+            request = &requests[request_count++];
+            *request = {pixels, 0, false};
+        }
+        if (request != nullptr && !request->asked) {
+            request->asked = true;
+            request->frames += 1;
+        }
+
+        Entry *nearest = nullptr;
+        for (Entry &entry: entries) {
+            if (entry.pixels != 0 && (nearest == nullptr || abs(entry.pixels - pixels) < abs(nearest->pixels - pixels))) {
+                nearest = &entry;
+            }
+        }
+        bool settled = request != nullptr && request->frames >= FONT_CACHE_SETTLE_FRAMES;
+        if (nearest == nullptr || (nearest->pixels != pixels && (settled || abs(nearest->pixels - pixels) * 3 > pixels))) {
+            nearest = bake(pixels);
+        }
+        nearest->used = clock;
+        return &nearest->font;
+    }
+
+    // Call once a frame after the get()s; sizes that weren't asked for this frame start
+    // settling over.
+    void end_frame() {
+        for (int i = 0; i < request_count;) {
+            if (requests[i].asked) {
+                requests[i].asked = false;
+                i += 1;
+            } else {
+                requests[i] = requests[--request_count];
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        int pixels = 0;// 0 for a free slot
+        uint64_t used = 0;
+        Font font;
+    };
+
+    struct Request {
+        int pixels;
+        int frames;
+        bool asked;
+    };
+
+    // Fonts fetched this frame are the most recently used, so they are never the ones
+    // destroyed here
+    Entry *bake(int pixels) {
+        Entry *slot = &entries[0];
+        for (Entry &entry: entries) {
+            if (entry.pixels == 0) {
+                slot = &entry;
+                break;
+            }
+            if (entry.used < slot->used) {
+                slot = &entry;
+            }
+        }
+        if (slot->pixels != 0) {
+            destroy_font(&slot->font);
+        }
+        slot->pixels = pixels;
+        slot->font = Font(data, data_len, (float) pixels);
+        return slot;
+    }
+
+    unsigned char *data = nullptr;
+    int data_len = 0;
+
+    Entry entries[FONT_CACHE_SIZE];
+    uint64_t clock = 0;
+
+    Request requests[FONT_CACHE_SIZE];
+    int request_count = 0;
+};
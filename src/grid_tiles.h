@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cstdint>
+
+using namespace jovial;
+
+// Side of a tile in squares
+#define GRID_TILE_SIZE 16
+
+// How many open squares each GRID_TILE_SIZE x GRID_TILE_SIZE tile of the grid has, so the
+// huge grids that are mostly blocks can skip whole tiles of them when drawing and saving,
+// and a stamp per tile that moves on whenever anything in it changes, so what is drawn
+// can be kept between frames. Tiles on the right and bottom edge are cut off by the grid.
+// '\0' is a block.
+struct GridTiles {
+    void build(Vector2i grid_size, const char *letters) {
+        resize(grid_size);
+        for (int tile = 0; tile < count.x * count.y; ++tile) {
+            recount(letters, tile);
+        }
+    }
+
+    // Lays the tiles out over a grid of `grid_size` without counting anything
+    void resize(Vector2i grid_size) {
+        size = grid_size;
+        count = {(size.x + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE, (size.y + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE};
+        open.clear();
+        stamps.clear();
+        for (int tile = 0; tile < count.x * count.y; ++tile) {
+            open.push_back(0);
+            stamps.push_back(0);
+        }
+    }
+
+    // Call after `coord` turned from a block into an open square or back.
+    void update(const char *letters, Vector2i coord) {
+        recount(letters, tile_of(coord));
+        touch(coord);
+    }
+
+    // Call after anything else shown on `coord` changed.
+    void touch(Vector2i coord) {
+        stamps[tile_of(coord)] += 1;
+    }
+
+    [[nodiscard]] int tile_of(Vector2i coord) const {
+        return coord.y / GRID_TILE_SIZE * count.x + coord.x / GRID_TILE_SIZE;
+    }
+
+    [[nodiscard]] Vector2i start(int tile) const {
+        return {tile % count.x * GRID_TILE_SIZE, tile / count.x * GRID_TILE_SIZE};
+    }
+
+    // Width and height of `tile` in squares
+    [[nodiscard]] Vector2i extent(int tile) const {
+        Vector2i first = start(tile);
+        return {math::min(GRID_TILE_SIZE, size.x - first.x), math::min(GRID_TILE_SIZE, size.y - first.y)};
+    }
+
+    [[nodiscard]] bool all_blocks(int tile) const {
+        return open[tile] == 0;
+    }
+
+    [[nodiscard]] int tile_count() const {
+        return count.x * count.y;
+    }
+
+    Vector2i size;
+    // Tiles across and down
+    Vector2i count;
+    Vec<uint16_t> open;
+    Vec<uint32_t> stamps;
+
+private:
+    void recount(const char *letters, int tile) {
+        Vector2i first = start(tile);
+        Vector2i tile_size = extent(tile);
+        int squares = 0;
+        for (int y = first.y; y < first.y + tile_size.y; ++y) {
+            const char *row = letters + (size_t) y * size.x;
+            for (int x = first.x; x < first.x + tile_size.x; ++x) {
+                squares += row[x] != '\0' ? 1 : 0;
+            }
+        }
+        open[tile] = (uint16_t) squares;
+    }
+};
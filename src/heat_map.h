@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "./crossword.h"
+#include "./dictionary.h"
+#include "./pattern.h"
+#include "./slot_table.h"
+
+using namespace jovial;
+
+// Slot patterns remembered before the cache starts over
+#define HEAT_MAP_CACHE_SIZE 4096
+
+// What fits one slot: how many words, and the letters they have at each position.
+struct SlotFit {
+    uint32_t words = 0;
+    uint32_t letters[DICTIONARY_MAX_WORD_LEN] = {};
+};
+
+// Which letters are still possible in each cell, given the words that fit its across and
+// down slots as they are filled in so far. Only the slots edited since the last update()
+// are looked at again, and what fits a pattern like "C.T" is cached, since the same
+// patterns come back while typing and undoing.
+struct HeatMap {
+    // Catches up on the edits to `crossword` since the last call. Does nothing until the
+    // dictionary is ready.
+    void update(const Dictionary &dictionary, const Crossword &crossword) {
+        if (!dictionary.is_ready()) return;
+
+        const SlotTable &table = crossword.slots;
+        if (this->dictionary != &dictionary) {
+            this->dictionary = &dictionary;
+            cache.clear();
+            generation = table.generation - 1;
+        }
+
+        while (fits.size() < table.slots.size()) {
+            fits.push_back({});
+        }
+        if (generation != table.generation) {
+            generation = table.generation;
+            for (size_t s = 0; s < table.slots.size(); ++s) {
+                refresh(crossword, (int) s);
+            }
+        } else {
+            for (size_t i = read; i < table.edits.size(); ++i) {
+                refresh(crossword, table.edits[i]);
+            }
+        }
+        read = table.edits.size();
+    }
+
+    // The letters both slots through `coord` still allow there.
+    [[nodiscard]] uint32_t letters_at(const Crossword &crossword, Vector2i coord) const {
+        uint32_t mask = PATTERN_LETTERS;
+        int across = crossword.slots.across_slot(coord);
+        if (across != -1 && across < (int) fits.size()) {
+            mask &= fits[across].letters[coord.x - crossword.slots.slots[across].start.x];
+        }
+        int down = crossword.slots.down_slot(coord);
+        if (down != -1 && down < (int) fits.size()) {
+            mask &= fits[down].letters[coord.y - crossword.slots.slots[down].start.y];
+        }
+        return mask;
+    }
+
+    // Whether a slot through `coord` has no word left that fits.
+    [[nodiscard]] bool dead_at(const Crossword &crossword, Vector2i coord) const {
+        int across = crossword.slots.across_slot(coord);
+        int down = crossword.slots.down_slot(coord);
+        return (across != -1 && across < (int) fits.size() && fits[across].words == 0) ||
+               (down != -1 && down < (int) fits.size() && fits[down].words == 0);
+    }
+
+private:
+    void refresh(const Crossword &crossword, int s) {
+        const Slot &slot = crossword.slots.slots[s];
+        if (slot.len == 0) return;
+
+        std::string pattern;
+        for (int p = 0; p < slot.len; ++p) {
+            char c = crossword.letters[crossword.slots.cell(s, p)];
+            pattern += isalpha((unsigned char) c) ? (char) tolower(c) : '.';
+        }
+
+        auto cached = cache.find(pattern);
+        if (cached != cache.end()) {
+            fits[s] = cached->second;
+            return;
+        }
+        if (cache.size() >= HEAT_MAP_CACHE_SIZE) {
+            cache.clear();
+        }
+        fits[s] = fit(pattern);
+        cache[pattern] = fits[s];
+    }
+
+    [[nodiscard]] SlotFit fit(const std::string &pattern) {
+        SlotFit result;
+        int len = (int) pattern.size();
+        if (len > DICTIONARY_MAX_WORD_LEN) return result;
+
+        // Words of the right length with the pattern's letters and only letters elsewhere
+        const LengthBucket &bucket = dictionary->buckets[len];
+        domain.clear();
+        for (size_t block = 0; block < bucket.blocks; ++block) {
+            uint64_t bits = bucket.valid(block);
+            for (int p = 0; p < len && bits != 0; ++p) {
+                int letter = letter_index(pattern[p]);
+                bits &= letter != -1 ? bucket.posting(p, letter)[block] : ~bucket.allowed(p, PATTERN_OTHER_BIT, block);
+            }
+            domain.push_back(bits);
+            result.words += __builtin_popcountll(bits);
+        }
+        if (result.words == 0) return result;
+
+        // Few words are quicker to read off their rows; many words have every common letter
+        // early on in the posting lists
+        if (result.words <= bucket.blocks * 4) {
+            for (size_t block = 0; block < bucket.blocks; ++block) {
+                for (uint64_t bits = domain[block]; bits != 0; bits &= bits - 1) {
+                    const uint8_t *row = bucket.rows + (block * 64 + __builtin_ctzll(bits)) * bucket.stride;
+                    for (int p = 0; p < len; ++p) {
+                        result.letters[p] |= pattern_bit((char) row[p]);
+                    }
+                }
+            }
+            return result;
+        }
+        for (int p = 0; p < len; ++p) {
+            int letter = letter_index(pattern[p]);
+            if (letter != -1) {
+                result.letters[p] = (uint32_t) 1 << letter;
+                continue;
+            }
+            for (letter = 0; letter < DICTIONARY_LETTERS; ++letter) {
+                const uint64_t *posting = bucket.posting(p, letter);
+                for (size_t block = 0; block < bucket.blocks; ++block) {
+                    if ((domain[block] & posting[block]) != 0) {
+                        result.letters[p] |= (uint32_t) 1 << letter;
+                        break;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    const Dictionary *dictionary = nullptr;
+    std::unordered_map<std::string, SlotFit> cache;
+
+    // The words of the pattern being fitted, as a bitset over its length bucket
+    Vec<uint64_t> domain;
+
+    // Indexed by slot id, like SlotTable::slots
+    Vec<SlotFit> fits;
+    uint32_t generation = 0;
+    size_t read = 0;
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include <cstdint>
+
+#include "./dictionary.h"
+#include "./pattern.h"
+
+using namespace jovial;
+
+#define INCREMENTAL_SEARCH_MAX_DEPTH 64
+// Ids filtered between two looks at whether the search is still wanted
+#define INCREMENTAL_SEARCH_CANCEL_EVERY 4096
+
+// Candidates after `depth` pattern positions: every word at least `depth` long whose first
+// `depth` characters fit. While every position so far is a literal the candidates are
+// exactly a DAWG id range; after a wildcard the range is kept as long as possible and
+// only narrowed into explicit ids once a literal or class needs checking.
+struct SearchLevel {
+    uint32_t mask = 0;
+    char literal = 0;
+    bool literal_prefix = false;
+    bool is_range = false;
+    uint32_t first = 0;
+    uint32_t end = 0;
+    Vec<uint32_t> ids;
+};
+
+// Keeps one SearchLevel per pattern position, so appending a character only filters the
+// previous level and Backspace just drops back to the level below.
+//
+// The filtering loops call stopped() every INCREMENTAL_SEARCH_CANCEL_EVERY ids and give up
+// once it returns true, which it has to keep doing from then on. A level that was given up
+// on is not cached, so the next sync() starts it over.
+struct IncrementalSearch {
+    bool sync(const Dictionary &dictionary, const CompiledPattern &pattern) {
+        return sync(dictionary, pattern, [] { return false; });
+    }
+
+    // Brings the levels in line with `pattern`. Returns true when the candidates changed.
+    // After being stopped the levels only go part of the way, so for_each_match() is no use
+    // until the next sync().
+    template<typename S>
+    bool sync(const Dictionary &dictionary, const CompiledPattern &pattern, S &&stopped) {
+        if (!dictionary.is_ready()) return false;
+
+        bool changed = false;
+        if (!started) {
+            started = true;
+            changed = true;
+            SearchLevel &root = levels[0];
+            root.literal_prefix = true;
+            root.is_range = true;
+            root.first = 0;
+            root.end = dictionary.word_count;
+        }
+
+        // Levels above the current depth stay cached until something else is typed over them
+        int pattern_len = math::min(pattern.len, INCREMENTAL_SEARCH_MAX_DEPTH);
+        int common = 0;
+        while (common < cached_depth && common < pattern_len &&
+               levels[common + 1].mask == pattern.masks[common] && levels[common + 1].literal == pattern.literals[common]) {
+            common += 1;
+        }
+
+        int previous_depth = depth;
+        depth = common;
+        if (depth < pattern_len) {
+            cached_depth = depth;
+            while (depth < pattern_len) {
+                if (!push(dictionary, pattern, stopped)) break;
+            }
+            cached_depth = depth;
+            changed = true;
+        }
+        changed = changed || depth != previous_depth;
+
+        changed = changed || open_ended != pattern.open_ended;
+        open_ended = pattern.open_ended;
+        return changed;
+    }
+
+    // Calls on_match(id) for every word matching the whole pattern until it returns false.
+    template<typename F>
+    void for_each_match(const Dictionary &dictionary, F &&on_match) const {
+        for_each_match(dictionary, on_match, [] { return false; });
+    }
+
+    template<typename F, typename S>
+    void for_each_match(const Dictionary &dictionary, F &&on_match, S &&stopped) const {
+        if (!started || depth == 0) return;
+
+        for_each_candidate(levels[depth], [&](uint32_t id) {
+            uint32_t len = dictionary.spans[id].len;
+            if (len < (uint32_t) depth || (!open_ended && len != (uint32_t) depth)) return true;
+            return on_match(id);
+        }, stopped);
+    }
+
+    void reset() {
+        started = false;
+        depth = 0;
+        cached_depth = 0;
+    }
+
+    bool started = false;
+    bool open_ended = false;
+    int depth = 0;
+    int cached_depth = 0;
+    SearchLevel levels[INCREMENTAL_SEARCH_MAX_DEPTH + 1];
+
+private:
+    // Returns false when f() or stopped() ended it early.
+    template<typename F, typename S>
+    static bool for_each_candidate(const SearchLevel &level, F &&f, S &&stopped) {
+        if (level.is_range) {
+            for (uint32_t id = level.first; id < level.end; ++id) {
+                if ((id - level.first) % INCREMENTAL_SEARCH_CANCEL_EVERY == 0 && stopped()) return false;
+                if (!f(id)) return false;
+            }
+        } else {
+            for (size_t i = 0; i < level.ids.size(); ++i) {
+                if (i % INCREMENTAL_SEARCH_CANCEL_EVERY == 0 && stopped()) return false;
+                if (!f(level.ids[i])) return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns false, leaving the depth as it was, when stopped.
+    template<typename S>
+    bool push(const Dictionary &dictionary, const CompiledPattern &pattern, S &&stopped) {
+        int position = depth;
+        const SearchLevel &previous = levels[position];
+        SearchLevel &next = levels[position + 1];
+        depth += 1;
+
+        uint32_t mask = pattern.masks[position];
+        next.mask = mask;
+        next.literal = pattern.literals[position];
+        next.ids.clear();
+
+        if (next.literal != 0 && previous.literal_prefix) {
+            next.literal_prefix = true;
+            next.is_range = true;
+            if (!dictionary.dawg.prefix_range(pattern.literals, position + 1, &next.first, &next.end)) {
+                next.first = next.end = 0;
+            }
+            return true;
+        }
+
+        next.literal_prefix = false;
+        if (mask == PATTERN_ANY && previous.is_range) {
+            // Only the minimum length changed, which for_each_match checks anyway
+            next.is_range = true;
+            next.first = previous.first;
+            next.end = previous.end;
+            return true;
+        }
+
+        next.is_range = false;
+        bool finished;
+        if (!narrow_with_postings(dictionary, pattern, position, stopped, &finished)) {
+            auto min_len = (uint32_t) (position + 1);
+            finished = for_each_candidate(previous, [&](uint32_t id) {
+                const WordSpan &span = dictionary.spans[id];
+                if (span.len >= min_len && pattern.allows(position, dictionary.word_base[span.offset + position])) {
+                    next.ids.push_back(id);
+                }
+                return true;
+            }, stopped);
+        }
+        if (!finished) {
+            depth -= 1;
+        }
+        return finished;
+    }
+
+    // Many candidates are cheaper to narrow through the posting bitsets of every length bucket
+    // than by reading each word. That goes back to the last level that is still an id range
+    // and checks every position since then at once, a few bitset words per 64 words. Words too
+    // long for the buckets can't be found that way, and the bitsets can't tell one non-letter
+    // from another, so those cases read the words instead. Sets `finished` to false when stopped
+    // part of the way.
+    template<typename S>
+    bool narrow_with_postings(const Dictionary &dictionary, const CompiledPattern &pattern, int position, S &&stopped, bool *finished) {
+        if (dictionary.dawg.nodes[0].max_len > DICTIONARY_MAX_WORD_LEN) return false;
+
+        int from = position;
+        while (!levels[from].is_range) {
+            from -= 1;
+        }
+
+        size_t blocks = 0;
+        for (int len = position + 1; len <= DICTIONARY_MAX_WORD_LEN; ++len) {
+            blocks += dictionary.buckets[len].blocks;
+        }
+        const SearchLevel &previous = levels[position];
+        if (!previous.is_range && previous.ids.size() < blocks * (position + 1 - from) * 4) return false;
+
+        int checked[INCREMENTAL_SEARCH_MAX_DEPTH];
+        int checked_count = 0;
+        for (int q = from; q <= position; ++q) {
+            if (pattern.literals[q] != 0 && !pattern.letters_only(q)) return false;
+            if (!pattern.is_any(q)) {
+                checked[checked_count++] = q;
+            }
+        }
+
+        const SearchLevel &range = levels[from];
+        SearchLevel &next = levels[position + 1];
+        for (int len = position + 1; len <= DICTIONARY_MAX_WORD_LEN; ++len) {
+            const LengthBucket &bucket = dictionary.buckets[len];
+            if (bucket.count == 0) continue;
+
+            for (size_t block = 0; block < bucket.blocks; ++block) {
+                if (block % (INCREMENTAL_SEARCH_CANCEL_EVERY / 64) == 0 && stopped()) {
+                    *finished = false;
+                    return true;
+                }
+                uint64_t hits = bucket.valid(block);
+                for (int i = 0; i < checked_count && hits != 0; ++i) {
+                    hits &= bucket.allowed(checked[i], pattern.masks[checked[i]], block);
+                }
+                while (hits != 0) {
+                    uint32_t id = bucket.ids[block * 64 + __builtin_ctzll(hits)];
+                    hits &= hits - 1;
+                    if (id >= range.first && id < range.end) {
+                        next.ids.push_back(id);
+                    }
+                }
+            }
+        }
+        *finished = true;
+        return true;
+    }
+};
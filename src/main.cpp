@@ -11,7 +11,13 @@
 #include "Jovial/Std/Vector.h"
 #include "Jovial/Std/Vector2i.h"
 #include <cctype>
+#include <cstdio>
 
+#include "./autofill_job.h"
+#include "./autosave.h"
+#include "./crossword.h"
+#include "./crossword_drawer.h"
+#include "./heat_map.h"
 #include "./word_finder.h"
 
 using namespace jovial;
@@ -19,362 +25,6 @@ using namespace jovial;
 #define WINDOW_NAME "Sharewords"
 #define WINDOW_SIZE Vector2(1280, 720)
 #define WINDOW_RES Vector2(0, 0)
-#define PADDING (Window::get_current_width() / 40.0f)
-
-struct Answer {
-    char hint[64] = {0};
-
-    Vector2i coords;
-    int number = 0;
-
-    bool operator<(const Answer &other) const {
-        return number < other.number;
-    }
-};
-
-struct Crossword {
-    Vector2i size;
-    char *letters;
-    Vec<Answer> across;
-    Vec<Answer> down;
-    char title[30];
-
-    explicit Crossword(Vector2i size, const char *title) : size(size), title() {
-        letters = (char *) malloc(sizeof(char) * size.x * size.y);
-        for (int i = 0; i < size.x * size.y; ++i) {
-            letters[i] = '\0';
-        }
-        strcpy(this->title, title);
-    }
-
-    void reconstruct(const fs::Path &path) {
-        Crossword new_crossword(path);
-        strcpy(title, new_crossword.title);
-        size = new_crossword.size;
-        free(letters);
-        letters = new_crossword.letters;
-        new_crossword.letters = nullptr;
-
-        across.clear();
-        down.clear();
-        for (int i = 0; i < new_crossword.across.size(); ++i) {
-            across.push_back({});
-            strcpy(across[i].hint, new_crossword.across[i].hint);
-            across[i].number = new_crossword.across[i].number;
-            across[i].coords = new_crossword.across[i].coords;
-        }
-        for (int i = 0; i < new_crossword.down.size(); ++i) {
-            down.push_back({});
-            strcpy(down[i].hint, new_crossword.down[i].hint);
-            down[i].number = new_crossword.down[i].number;
-            down[i].coords = new_crossword.down[i].coords;
-        }
-    }
-
-    [[nodiscard]] bool contains(Vector2i coord) const {
-        return coord.x >= 0 && coord.y >= 0 && coord.x < size.x && coord.y < size.y;
-    }
-
-    [[nodiscard]] char at(Vector2i coord) const {
-        if (coord.x > size.x || coord.y > size.y) {
-            JV_CORE_ERROR("coord ", coord, " is larger than crossword size of ", size);
-            return '\0';
-        }
-
-        return letters[coord.y * size.x + coord.x];
-    }
-
-    void erase(Vector2i coord) {
-        if (coord.x > size.x || coord.y > size.y) {
-            JV_CORE_ERROR("coord ", coord, " is larger than crossword size of ", size);
-        } else {
-            for (int i = 0; i < across.size(); ++i) {
-                if (across[i].coords == coord) {
-                    across.swap_pop(i);
-                }
-            }
-            for (int i = 0; i < down.size(); ++i) {
-                if (down[i].coords == coord) {
-                    down.swap_pop(i);
-                }
-            }
-            set(coord, '\0');
-        }
-    }
-
-
-    void set(Vector2i coord, char c) const {
-        if (coord.x > size.x || coord.y > size.y) {
-            JV_CORE_ERROR("coord ", coord, " is larger than crossword size of ", size);
-        } else {
-            letters[coord.y * size.x + coord.x] = (char) toupper(c);
-        }
-    }
-
-    [[nodiscard]] float square_size() const {
-        auto winsize = Window::get_current_size() - Vector2(PADDING * 2);
-        winsize.y -= PADDING;
-        float x = winsize.x / (float) size.x;
-        float y = winsize.y / (float) size.y;
-        return math::min(x, y);
-    }
-
-    [[nodiscard]] Rect2 get_rect() const {
-        return {PADDING, PADDING, (float) size.x * square_size() + PADDING, (float) size.y * square_size() + PADDING};
-    }
-
-    void save_to(const fs::Path &path) const {
-        String output;
-        output += title;
-        output += "\n";
-        output += to_string(size.x) + " " + to_string(size.y) + "\n";
-
-        for (int i = 0; i < size.x * size.y; ++i) {
-            if (letters[i] == '\0') {
-                output += '~';
-            } else {
-                output += letters[i];
-            }
-        }
-        output += "across:\n";
-        for (auto &answer: across) {
-            output += to_string(answer.number) + ":" +
-                      to_string(answer.coords.x) + "," + to_string(answer.coords.y) + ":" +
-                      answer.hint + "\n";
-        }
-        output += "down:\n";
-        for (auto &answer: down) {
-            output += to_string(answer.number) + ":" +
-                      to_string(answer.coords.x) + "," + to_string(answer.coords.y) + ":" +
-                      answer.hint + "\n";
-        }
-        fs::write_entire_file(output, path);
-    }
-
-    explicit Crossword(const fs::Path &path) : letters(nullptr), title() {
-        String input = path.read_entire_file();
-        if (input.is_empty()) {
-            return;
-        }
-        StringView view(input.items, 0, input.count);
-
-        bool error = false;
-
-        StringView title_view = view.chop_to('\n');
-        for (int i = 0; i < title_view.size(); ++i) {
-            title[i] = title_view[i];
-        }
-        view.begin += title_view.size() + 1;
-
-        StringView width = view.chop_to(' ');
-        view.begin += width.size();
-        view.trim_lead();
-        size.x = atoi(width, &error);
-        if (error) {
-            JV_CORE_FATAL("could not load ", width, ": ", path.str)
-        }
-
-        StringView height = view.chop_to('\n');
-        view.begin += height.size();
-        view.trim_lead();
-        size.y = atoi(height, &error);
-        if (error) {
-            JV_CORE_FATAL("could not load ", path.str)
-        }
-
-        printj("Loaded crossword size: ", size.x, ", ", size.y);
-
-        letters = (char *) malloc(sizeof(char) * size.x * size.y);
-        for (int i = 0; i < size.x * size.y; ++i) {
-            char c = view.first();
-            if (c == '~') {
-                letters[i] = '\0';
-            } else {
-                letters[i] = c;
-            }
-            view.begin += 1;
-        }
-
-        view.begin += view.chop_to('\n').size() + 1;// skip 'across:'
-        if (view.size() == 0) return;
-
-        while (view.first() != 'd') {// down:
-            StringView num = view.chop_to(':');
-            view.begin += num.size() + 1;
-
-            StringView x = view.chop_to(',');
-            view.begin += x.size() + 1;
-
-            StringView y = view.chop_to(':');
-            view.begin += y.size() + 1;
-
-            StringView hint = view.chop_to('\n');
-            view.begin += hint.size() + 1;
-
-            Answer answer;
-
-            answer.number = atoi(num, &error);
-            if (error) { JV_CORE_FATAL("could not load ", path.str) }
-
-            answer.coords.x = atoi(x, &error);
-            if (error) { JV_CORE_FATAL("could not load ", path.str) }
-
-            answer.coords.y = atoi(y, &error);
-            if (error) { JV_CORE_FATAL("could not load ", path.str) }
-
-            for (int i = 0; i < hint.size(); ++i) {
-                answer.hint[i] = hint[i];
-            }
-
-            across.push_back(answer);
-        }
-
-        view.begin += view.chop_to('\n').size() + 1;// skip 'down:'
-        if (view.size() == 0) return;
-
-        while (view.size() > 0) {// down:
-            StringView num = view.chop_to(':');
-            view.begin += num.size() + 1;
-
-            StringView x = view.chop_to(',');
-            view.begin += x.size() + 1;
-
-            StringView y = view.chop_to(':');
-            view.begin += y.size() + 1;
-
-            StringView hint = view.chop_to('\n');
-            view.begin += hint.size() + 1;
-
-            Answer answer;
-
-            answer.number = atoi(num, &error);
-            if (error) { JV_CORE_FATAL("could not load ", path.str) }
-
-            answer.coords.x = atoi(x, &error);
-            if (error) { JV_CORE_FATAL("could not load ", path.str) }
-
-            answer.coords.y = atoi(y, &error);
-            if (error) { JV_CORE_FATAL("could not load ", path.str) }
-
-            for (int i = 0; i < hint.size(); ++i) {
-                answer.hint[i] = hint[i];
-            }
-
-            down.push_back(answer);
-        }
-    }
-
-    ~Crossword() {
-        free(letters);
-    }
-};
-
-void draw_number(Vector2 position, int number, Font *font) {
-    String str = to_string(number);
-    for (int i = 0; i < str.count; ++i) {
-        int index = str[i] - font->first_char;
-        Glyph &glyph = font->glyphs[index];
-
-        auto padding = (float) font->padding;
-        Rect2 uv = {font->rects[index].x - padding, font->rects[index].y - padding,
-                    font->rects[index].w + padding, font->rects[index].h + padding};
-
-        uv.x /= (float) font->texture.width;
-        uv.y /= (float) font->texture.height;
-        uv.w /= (float) font->texture.width;
-        uv.h /= (float) font->texture.height;
-
-        rendering::TextureDrawProperties props;
-        props.centered = true;
-        props.scale = Vector2(1.0f / 2);
-        props.uv = uv;
-        props.size = {font->size, font->size};
-        props.color = Colors::Black;
-
-        rendering::draw_texture(font->texture, position + Vector2(font->size / 5, font->size / 1.3f), props);
-    }
-}
-
-struct CrosswordDrawer {
-    CrosswordDrawer() {
-        font_data_len = 0;
-        font_data = fs::read_file_data(JV_FONTS_DIR JV_SEP "jet_brains.ttf", &font_data_len);
-    }
-
-    void update_square_size(const Crossword &crossword) {
-        float new_square_size = crossword.square_size();
-        if (square_size != new_square_size) {
-            square_size = new_square_size;
-            destroy_font(&font);
-            font = Font(font_data, font_data_len, square_size);
-            hints_font = Font(font_data, font_data_len, square_size / 1.5f);
-        }
-    }
-
-    void draw_lines(const Crossword &crossword) const {
-        for (int x = 0; x < crossword.size.x + 1; ++x) {
-            rendering::draw_line({Vector2((float) x * square_size + PADDING, PADDING),
-                                  Vector2((float) x * square_size + PADDING, (float) Window::get_current_height() - PADDING * 2)},
-                                 2.0f,
-                                 {.color = Colors::Black});
-        }
-        for (int y = 0; y < crossword.size.y + 1; ++y) {
-            rendering::draw_line({Vector2(PADDING, (float) y * square_size + PADDING),
-                                  Vector2((float) Window::get_current_height() - PADDING * 2, (float) y * square_size + PADDING)},
-                                 2.0f,
-                                 {.color = Colors::Black});
-        }
-    }
-
-    void draw(const Crossword &crossword) {
-        update_square_size(crossword);
-        draw_lines(crossword);
-
-        Rect2 base_square({0.0f, 0.0f}, {square_size, square_size});
-
-        font.draw({PADDING, (float) Window::get_current_height() - PADDING * 1.25f},
-                  crossword.title);
-
-        for (int x = 0; x < crossword.size.x; ++x) {
-            for (int y = 0; y < crossword.size.y; ++y) {
-                Vector2 pos = Vector2((float) x * square_size, (float) y * square_size) + Vector2(PADDING);
-
-                char letter = crossword.at({x, y});
-
-                if (letter == '\0') {
-                    rendering::ShapeDrawProperties props{};
-                    props.color = Colors::Black;
-                    Rect2 square = base_square.move(pos);
-                    rendering::draw_rect2(square, props);
-                } else if (!hidden) {
-                    draw_char(pos, letter, &font);
-                }
-            }
-        }
-        draw_answer_numbers(crossword);
-    }
-
-    void draw_answer_numbers(const Crossword &crossword) {
-        for (auto &answer: crossword.across) {
-            Vector2 pos = Vector2((float) answer.coords.x * square_size, (float) answer.coords.y * square_size) +
-                          Vector2(PADDING);
-            draw_number(pos, answer.number, &font);
-        }
-        for (auto &answer: crossword.down) {
-            Vector2 pos = Vector2((float) answer.coords.x * square_size, (float) answer.coords.y * square_size) +
-                          Vector2(PADDING);
-            draw_number(pos, answer.number, &font);
-        }
-    }
-
-    bool hidden = false;
-
-    float square_size = 0;
-    Font font;
-    Font hints_font;
-    unsigned char *font_data;
-    int font_data_len;
-};
 
 struct CrosswordHinter {
     CrosswordHinter() = default;
@@ -391,7 +41,7 @@ struct CrosswordHinter {
         drawer.hints_font.draw(hint_pos, "Down:");
         hint_pos.y -= drawer.hints_font.size;
         for (int i = 0; i < crossword.down.size(); ++i) {
-            drawer.hints_font.draw(hint_pos, to_string(crossword.down[i].number) + ".");
+            drawer.hints_font.draw(hint_pos, number_text(crossword.down[i].number));
             drawer.hints_font.draw(hint_pos + offset, crossword.down[i].hint, {.fix_start_pos = true});
 
             edit_hint(false, i, hint_pos, crossword, drawer);
@@ -404,7 +54,7 @@ struct CrosswordHinter {
         drawer.hints_font.draw(hint_pos, "Across:");
         hint_pos.y -= drawer.hints_font.size;
         for (int i = 0; i < crossword.across.size(); ++i) {
-            drawer.hints_font.draw(hint_pos, to_string(crossword.across[i].number) + ".");
+            drawer.hints_font.draw(hint_pos, number_text(crossword.across[i].number));
             drawer.hints_font.draw(hint_pos + offset, crossword.across[i].hint, {.fix_start_pos = true});
 
             edit_hint(true, i, hint_pos, crossword, drawer);
@@ -413,7 +63,13 @@ struct CrosswordHinter {
         }
     }
 
-    void edit_hint(bool horizontal, int i, Vector2 hint_pos, const Crossword &crossword, const CrosswordDrawer &drawer) {
+    // Clues numbered 0 lost their word to a block, see Crossword::number_answers()
+    static String number_text(int number) {
+        if (number == 0) return String("-.");
+        return to_string(number) + ".";
+    }
+
+    void edit_hint(bool horizontal, int i, Vector2 hint_pos, Crossword &crossword, const CrosswordDrawer &drawer) {
         Vector2 mpos = Input::get_mouse_position();
         Vector2 offset(PADDING, 0.0f);
 
@@ -434,21 +90,20 @@ struct CrosswordHinter {
             rendering::draw_line({cursor_pos, cursor_pos + Vector2(0.0f, drawer.hints_font.size * 0.75f)},
                                  2.0f, {.color = Colors::Black});
 
-            auto *list = &crossword.down;
-            if (horizontal) {
-                list = &crossword.across;
-            }
+            // An undo may have shortened the hint under the cursor
+            const char *hint = horizontal ? crossword.across[i].hint : crossword.down[i].hint;
+            char_index = math::min(char_index, (int) strlen(hint));
 
             for (char c: Input::get_chars_typed()) {
-                if (char_index < JV_ARRAY_LEN((*list)[i].hint)) {
-                    (*list)[i].hint[char_index] = c;
+                if (char_index < SHAREWORD_MAX_HINT_LEN) {
+                    crossword.set_hint(horizontal, i, char_index, c);
                     char_index += 1;
                 }
             }
             if (Input::is_typed(Actions::Backspace)) {
                 if (char_index > 0) {
                     char_index -= 1;
-                    (*list)[i].hint[char_index] = '\0';
+                    crossword.set_hint(horizontal, i, char_index, '\0');
                 }
             }
             if (Input::is_typed(Actions::Enter) || Input::is_typed(Actions::Escape)) {
@@ -503,16 +158,14 @@ struct CrosswordNavigator {
     }
 
     void move(int direction, const Crossword &crossword) {
-        Vector2i new_square = current_square + direction_vector(direction);
-        if (crossword.contains(new_square)) {
-            current_square = new_square;
-        }
+        move(direction_vector(direction), crossword);
     }
 
     void move(Vector2i direction, const Crossword &crossword) {
         Vector2i new_square = current_square + direction;
         if (crossword.contains(new_square)) {
             current_square = new_square;
+            status = nullptr;
         }
     }
 
@@ -560,59 +213,30 @@ struct CrosswordNavigator {
 
         if (Input::is_just_pressed(Actions::Enter)) {
             if (Input::is_pressed(Actions::LeftControl)) {
-                for (int i = 0; i < crossword.across.size(); ++i) {
-                    if (crossword.across[i].coords == current_square) {
-                        crossword.across.swap_pop(i);
-                    }
-                }
-                for (int i = 0; i < crossword.down.size(); ++i) {
-                    if (crossword.down[i].coords == current_square) {
-                        crossword.down.swap_pop(i);
+                for (bool across: {true, false}) {
+                    int i = crossword.find_answer(across, current_square);
+                    if (i != -1) {
+                        crossword.remove_answer(across, i);
                     }
                 }
             } else if (crossword.at(current_square) != '\0') {
-                Answer answer;
-                answer.coords = current_square;
-                strcpy(answer.hint, "Hint");
-
-                int num = -1;
-                for (auto &a: crossword.across) {
-                    if (a.coords == current_square)
-                        num = a.number;
-                }
-                for (auto &a: crossword.down) {
-                    if (a.coords == current_square)
-                        num = a.number;
-                }
-
-                if (mode == DOWN || mode == UP) {
-                    if (num == -1) {
-                        num = crossword.down.count + 1;
-                    } else {
-                        for (auto &a: crossword.down) {
-                            if (a.number == num) {
-                                a.number += 1;
-                                break;
-                            }
-                        }
-                    }
-                    answer.number = num;
-                    crossword.down.push_back(answer);
-                    crossword.down.sort();
-                } else if (mode == LEFT || mode == RIGHT) {
-                    if (num == -1) {
-                        num = crossword.across.count + 1;
-                    } else {
-                        for (auto &a: crossword.across) {
-                            if (a.number == num) {
-                                a.number += 1;
-                                break;
-                            }
-                        }
-                    }
-                    answer.number = num;
-                    crossword.across.push_back(answer);
-                    crossword.across.sort();
+                // Adds a clue for the word the square is in, at the square it starts on,
+                // which need not be the one the cursor is on
+                bool across = mode == LEFT || mode == RIGHT;
+                int slot = across ? crossword.slots.across_slot(current_square) : crossword.slots.down_slot(current_square);
+                if (mode == NONE) {
+                    status = "Type a direction first to pick the word to add a clue for";
+                } else if (slot == -1) {
+                    status = across ? "This square isn't in an across word" : "This square isn't in a down word";
+                } else if (crossword.find_answer(across, crossword.slots.slots[slot].start) != -1) {
+                    status = "That word already has a clue";
+                } else {
+                    Answer answer;
+                    answer.coords = crossword.slots.slots[slot].start;
+                    answer.number = crossword.number_at(answer.coords);
+                    strcpy(answer.hint, "Hint");
+                    crossword.add_answer(across, answer);
+                    status = answer.coords == current_square ? nullptr : "Added the clue on the first square of the word";
                 }
             }
         }
@@ -689,6 +313,7 @@ struct CrosswordNavigator {
         Vector2i new_square = (Input::get_mouse_position() - Vector2(PADDING)) / drawer.square_size;
         if (crossword.contains(new_square)) {
             current_square = new_square;
+            status = nullptr;
         }
         if (Input::is_pressed(Actions::LeftControl)) {
             crossword.erase(current_square);
@@ -696,6 +321,8 @@ struct CrosswordNavigator {
     }
 
     Vector2i current_square = {};
+    // What the last Enter did, if it needs saying, until the cursor moves
+    const char *status = nullptr;
     enum {
         NONE,
         RIGHT,
@@ -772,11 +399,11 @@ struct Exporter {
 
 class World : public Node {
 public:
-    World() : crossword({20, 20}, "Untitled crossword") {}
+    World() : crossword({20, 20}, "Untitled crossword"), saver(fs::Path::res() + "autosave.shareword") {}
 
     void update() override {
         if (Input::is_just_released(Actions::F1)) {
-            crossword.save_to(fs::Path::res() + "crossword.shareword");
+            saver.save(crossword, fs::Path::res() + "crossword.shareword");
         }
         if (Input::is_just_released(Actions::F2)) {
             drawer.hidden = !drawer.hidden;
@@ -784,7 +411,22 @@ public:
         if (Input::is_just_released(Actions::F3)) {
             take_screenshot("./shareword.png");
         }
-        drawer.draw(crossword);
+        if (Input::is_just_released(Actions::F4)) {
+            autofill.toggle(&word_finder.dictionary, crossword);
+        }
+        if (Input::is_just_released(Actions::F5)) {
+            heat_shown = !heat_shown;
+        }
+        if (Input::is_just_released(Actions::F6)) {
+            stats_shown = !stats_shown;
+        }
+        autofill.poll(crossword);
+        saver.update(crossword);
+        if (heat_shown) {
+            word_finder.dictionary.index_in_background();
+            heat_map.update(word_finder.dictionary, crossword);
+        }
+        drawer.draw(crossword, heat_shown ? &heat_map : nullptr);
 
         if (Input::is_action_just_pressed(Actions::F) &&
             (Input::is_pressed(Actions::LeftControl) || Input::is_pressed(Actions::RightControl))) {
@@ -798,6 +440,19 @@ public:
             (Input::is_pressed(Actions::LeftControl) || Input::is_pressed(Actions::RightControl))) {
             exporter.export_crossword();
         }
+        // Ctrl+Z undoes, Ctrl+Shift+Z and Ctrl+Y redo
+        if (Input::is_action_just_pressed(Actions::Z) &&
+            (Input::is_pressed(Actions::LeftControl) || Input::is_pressed(Actions::RightControl))) {
+            if (Input::is_pressed(Actions::LeftShift)) {
+                crossword.redo();
+            } else {
+                crossword.undo();
+            }
+        }
+        if (Input::is_action_just_pressed(Actions::Y) &&
+            (Input::is_pressed(Actions::LeftControl) || Input::is_pressed(Actions::RightControl))) {
+            crossword.redo();
+        }
 
         if (!hinter.editing() && !word_finding && !exporter.importing && !exporter.exporting) {
             navigator.navigate(crossword, drawer);
@@ -809,10 +464,23 @@ public:
 
         Rect2 rect = crossword.get_rect();
         exporter.update(&drawer.hints_font, Vector2(rect.w + PADDING, rect.h / 2));
+        if (autofill.status != nullptr) {
+            drawer.hints_font.draw(Vector2(rect.w + PADDING, PADDING / 3), autofill.status);
+        }
+        if (navigator.status != nullptr) {
+            drawer.hints_font.draw(Vector2(rect.w + PADDING, PADDING / 3 + drawer.hints_font.size), navigator.status);
+        }
+        if (stats_shown) {
+            char stats[64];
+            snprintf(stats, sizeof(stats), "%d renderer calls, %d tiles laid out", drawer.renderer_calls, drawer.tiles_laid_out);
+            drawer.hints_font.draw(Vector2(rect.w + PADDING, (float) Window::get_current_height() - PADDING * 1.25f), stats);
+        }
         if (exporter.finished) {
             if (exporter.exporting) {
-                crossword.save_to(fs::Path(exporter.filename));
+                saver.save(crossword, fs::Path(exporter.filename));
             } else if (exporter.importing) {
+                // The file may be one a save is still writing
+                saver.flush();
                 crossword.reconstruct(fs::Path(exporter.filename));
             }
         }
@@ -824,6 +492,7 @@ public:
                 word_finding = false;
             }
         }
+        crossword.end_step();
     }
 
     Crossword crossword;
@@ -834,6 +503,19 @@ public:
 
     WordFinder word_finder;
     bool word_finding = false;
+
+    // F4 fills every open square, and cancels a fill that is still running
+    AutofillJob autofill;
+
+    // F5 shades every open square by how few letters still fit there
+    HeatMap heat_map;
+    bool heat_shown = false;
+
+    // F6 shows how much the grid took to draw this frame
+    bool stats_shown = false;
+
+    // Every save is written on its own thread, and the puzzle is autosaved now and then
+    Autosave saver;
 };
 
 int main() {
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace jovial;
+
+// Copies a path into a null-terminated buffer for the POSIX calls below.
+inline const char *path_to_cstr(const fs::Path &path, char *buffer, size_t capacity) {
+    size_t len = math::min((size_t) path.str.count, capacity - 1);
+    memcpy(buffer, path.str.items, len);
+    buffer[len] = '\0';
+    return buffer;
+}
+
+// Size and modification time, used to tell whether a derived file is still up to date.
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t modified = 0;
+
+    bool operator==(const FileStamp &other) const {
+        return size == other.size && modified == other.modified;
+    }
+
+    static bool of(const fs::Path &path, FileStamp *stamp) {
+        char name[4096];
+        struct stat info {};
+        if (stat(path_to_cstr(path, name, sizeof(name)), &info) == -1) {
+            return false;
+        }
+        stamp->size = (uint64_t) info.st_size;
+        stamp->modified = (int64_t) info.st_mtime;
+        return true;
+    }
+};
+
+// Writes next to `path` first and renames over it once the data is on disk, so a crash or
+// a full disk leaves either the old file or the new one, never half of each. The temporary
+// name is unique, so saves of the same file from several threads don't write into each other.
+inline bool write_file_atomically(const fs::Path &path, const char *data, size_t size) {
+    char name[4096];
+    char temp[4096 + 8];
+    path_to_cstr(path, name, sizeof(name));
+    snprintf(temp, sizeof(temp), "%s.XXXXXX", name);
+
+    int fd = mkstemp(temp);
+    if (fd != -1 && fchmod(fd, 0644) != 0) {
+        close(fd);
+        unlink(temp);
+        fd = -1;
+    }
+    if (fd == -1) {
+        JV_CORE_ERROR("could not write ", path.str, ": ", strerror(errno));
+        return false;
+    }
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write(fd, data + written, size - written);
+        if (result == -1 && errno == EINTR) continue;
+        if (result <= 0) break;
+        written += (size_t) result;
+    }
+    bool ok = written == size && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp, name) != 0) {
+        JV_CORE_ERROR("could not write ", path.str, ": ", strerror(errno));
+        unlink(temp);
+        return false;
+    }
+    return true;
+}
+
+// Read-only view of a whole file, shared with the page cache instead of copied to the heap.
+struct MappedFile {
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool map(const fs::Path &path) {
+        unmap();
+
+        char name[4096];
+        int fd = open(path_to_cstr(path, name, sizeof(name)), O_RDONLY);
+        if (fd == -1) {
+            JV_CORE_ERROR("could not open ", path.str);
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) == -1 || info.st_size == 0) {
+            close(fd);
+            return false;
+        }
+
+        void *mapping = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            JV_CORE_ERROR("could not map ", path.str);
+            return false;
+        }
+
+        data = (char *) mapping;
+        size = (size_t) info.st_size;
+        return true;
+    }
+
+    void unmap() {
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+        data = nullptr;
+        size = 0;
+    }
+
+    [[nodiscard]] StringView view() const {
+        return {data, 0, size};
+    }
+
+    ~MappedFile() {
+        unmap();
+    }
+
+    char *data = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MATCH_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// Masked compare over fixed-width rows: all words of a bucket stored back to back, each
+// padded with zeros to `stride` bytes (8, 16 or 32). A row matches when every byte selected
+// by `mask` equals the same byte of `value`; `value` must already be and-ed with `mask`.
+// Bit i of `out` is set for every matching row i, and the number of matches is returned.
+using MatchKernel = size_t (*)(const uint8_t *rows, size_t count, int stride,
+                               const uint8_t *value, const uint8_t *mask, uint64_t *out);
+
+enum class MatchIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+[[nodiscard]] inline const char *match_isa_name(MatchIsa isa) {
+    switch (isa) {
+        case MatchIsa::Scalar:
+            return "scalar";
+        case MatchIsa::SSE2:
+            return "sse2";
+        case MatchIsa::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+[[nodiscard]] inline int match_stride(int len) {
+    if (len <= 8) return 8;
+    if (len <= 16) return 16;
+    return 32;
+}
+
+[[nodiscard]] inline bool match_row(const uint8_t *row, int stride, const uint8_t *value, const uint8_t *mask) {
+    uint64_t diff = 0;
+    for (int lane = 0; lane < stride; lane += 8) {
+        uint64_t bytes, values, masks;
+        memcpy(&bytes, row + lane, 8);
+        memcpy(&values, value + lane, 8);
+        memcpy(&masks, mask + lane, 8);
+        diff |= (bytes & masks) ^ values;
+    }
+    return diff == 0;
+}
+
+inline size_t match_rows_scalar(const uint8_t *rows, size_t count, int stride,
+                                const uint8_t *value, const uint8_t *mask, uint64_t *out) {
+    memset(out, 0, (count + 63) / 64 * sizeof(uint64_t));
+    size_t matched = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (match_row(rows + i * stride, stride, value, mask)) {
+            out[i / 64] |= (uint64_t) 1 << (i % 64);
+            matched += 1;
+        }
+    }
+    return matched;
+}
+
+#ifdef MATCH_KERNEL_X86
+// Finishes the rows after the last full 64-row block one at a time.
+inline size_t match_tail(const uint8_t *rows, size_t first, size_t count, int stride,
+                         const uint8_t *value, const uint8_t *mask, uint64_t *out) {
+    if (first >= count) return 0;
+    uint64_t bits = 0;
+    for (size_t i = first; i < count; ++i) {
+        if (match_row(rows + i * stride, stride, value, mask)) {
+            bits |= (uint64_t) 1 << (i - first);
+        }
+    }
+    out[first / 64] = bits;
+    return __builtin_popcountll(bits);
+}
+
+// One bit per 32-bit lane whose masked bytes equal the pattern.
+__attribute__((target("sse2"))) inline uint32_t match_lanes_sse2(const uint8_t *at, __m128i value, __m128i mask) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *) at);
+    return (uint32_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bytes, mask), value)));
+}
+
+// One bit per 64-bit lane whose masked bytes equal the pattern.
+__attribute__((target("avx2"))) inline uint32_t match_lanes_avx2(const uint8_t *at, __m256i value, __m256i mask) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i *) at);
+    return (uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(bytes, mask), value)));
+}
+
+// Every register load covers `32 / stride` rows (or half a row at stride 32 for SSE2), and the
+// per-lane compare results are folded straight into one output word per 64 rows.
+__attribute__((target("sse2"))) inline size_t match_rows_sse2(const uint8_t *rows, size_t count, int stride,
+                                                               const uint8_t *value, const uint8_t *mask, uint64_t *out) {
+    alignas(16) uint8_t values[32], masks[32];
+    for (int i = 0; i < 32; ++i) {
+        values[i] = value[i % stride];
+        masks[i] = mask[i % stride];
+    }
+    __m128i v0 = _mm_load_si128((const __m128i *) values);
+    __m128i m0 = _mm_load_si128((const __m128i *) masks);
+    __m128i v1 = _mm_load_si128((const __m128i *) (values + 16));
+    __m128i m1 = _mm_load_si128((const __m128i *) (masks + 16));
+
+    size_t matched = 0;
+    size_t full_blocks = count / 64;
+    for (size_t block = 0; block < full_blocks; ++block) {
+        const uint8_t *base = rows + block * 64 * stride;
+        uint64_t bits = 0;
+        if (stride == 8) {
+            for (int k = 0; k < 32; ++k) {
+                uint32_t lane = match_lanes_sse2(base + k * 16, v0, m0);
+                uint32_t both = lane & (lane >> 1);
+                bits |= (uint64_t) ((both & 1) | ((both >> 1) & 2)) << (k * 2);
+            }
+        } else if (stride == 16) {
+            for (int k = 0; k < 64; ++k) {
+                bits |= (uint64_t) (match_lanes_sse2(base + k * 16, v0, m0) == 0xF) << k;
+            }
+        } else {
+            for (int k = 0; k < 64; ++k) {
+                uint32_t lane = match_lanes_sse2(base + k * 32, v0, m0) & match_lanes_sse2(base + k * 32 + 16, v1, m1);
+                bits |= (uint64_t) (lane == 0xF) << k;
+            }
+        }
+        out[block] = bits;
+        matched += __builtin_popcountll(bits);
+    }
+    return matched + match_tail(rows, full_blocks * 64, count, stride, value, mask, out);
+}
+
+__attribute__((target("avx2"))) inline size_t match_rows_avx2(const uint8_t *rows, size_t count, int stride,
+                                                               const uint8_t *value, const uint8_t *mask, uint64_t *out) {
+    alignas(32) uint8_t values[32], masks[32];
+    for (int i = 0; i < 32; ++i) {
+        values[i] = value[i % stride];
+        masks[i] = mask[i % stride];
+    }
+    __m256i v = _mm256_load_si256((const __m256i *) values);
+    __m256i m = _mm256_load_si256((const __m256i *) masks);
+
+    size_t matched = 0;
+    size_t full_blocks = count / 64;
+    for (size_t block = 0; block < full_blocks; ++block) {
+        const uint8_t *base = rows + block * 64 * stride;
+        uint64_t bits = 0;
+        if (stride == 8) {
+            for (int k = 0; k < 16; ++k) {
+                bits |= (uint64_t) match_lanes_avx2(base + k * 32, v, m) << (k * 4);
+            }
+        } else if (stride == 16) {
+            for (int k = 0; k < 32; ++k) {
+                uint32_t lane = match_lanes_avx2(base + k * 32, v, m);
+                uint32_t both = lane & (lane >> 1);
+                bits |= (uint64_t) ((both & 1) | ((both >> 1) & 2)) << (k * 2);
+            }
+        } else {
+            for (int k = 0; k < 64; ++k) {
+                bits |= (uint64_t) (match_lanes_avx2(base + k * 32, v, m) == 0xF) << k;
+            }
+        }
+        out[block] = bits;
+        matched += __builtin_popcountll(bits);
+    }
+    return matched + match_tail(rows, full_blocks * 64, count, stride, value, mask, out);
+}
+#endif
+
+[[nodiscard]] inline bool match_isa_supported(MatchIsa isa) {
+    switch (isa) {
+        case MatchIsa::Scalar:
+            return true;
+#ifdef MATCH_KERNEL_X86
+        case MatchIsa::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case MatchIsa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+[[nodiscard]] inline MatchKernel match_kernel(MatchIsa isa) {
+    switch (isa) {
+#ifdef MATCH_KERNEL_X86
+        case MatchIsa::SSE2:
+            return match_rows_sse2;
+        case MatchIsa::AVX2:
+            return match_rows_avx2;
+#endif
+        default:
+            return match_rows_scalar;
+    }
+}
+
+// Best kernel for the running CPU, picked once.
+[[nodiscard]] inline MatchKernel best_match_kernel() {
+    static MatchKernel kernel = [] {
+        if (match_isa_supported(MatchIsa::AVX2)) return match_kernel(MatchIsa::AVX2);
+        if (match_isa_supported(MatchIsa::SSE2)) return match_kernel(MatchIsa::SSE2);
+        return match_kernel(MatchIsa::Scalar);
+    }();
+    return kernel;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include <algorithm>
+#include <cstdint>
+
+#include "./dictionary.h"
+
+using namespace jovial;
+
+struct RankedMatch {
+    uint32_t score;
+    uint32_t id;
+};
+
+// Higher scores first, ties in word list order.
+[[nodiscard]] inline bool ranks_before(const RankedMatch &a, const RankedMatch &b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.id < b.id;
+}
+
+// Every match of a pattern with its score. Only the front of the buffer that is actually
+// shown gets put in order, so huge result sets are never sorted as a whole.
+struct MatchResults {
+    void clear() {
+        matches.clear();
+        ranked = 0;
+    }
+
+    // New matches may outrank the ones already in order, so ranking starts over.
+    void append(const RankedMatch *more, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            matches.push_back(more[i]);
+        }
+        ranked = 0;
+    }
+
+    // Makes sure the best `count` matches are in order at the front. Each call at least doubles
+    // the ranked part, and only the unranked rest is searched through a bounded heap.
+    void rank(size_t count) {
+        count = math::min(count, matches.size());
+        if (count <= ranked) return;
+
+        count = math::min(math::max(count, ranked * 2), matches.size());
+        std::partial_sort(matches.begin() + ranked, matches.begin() + count, matches.end(), ranks_before);
+        ranked = count;
+    }
+
+    [[nodiscard]] size_t total() const {
+        return matches.size();
+    }
+
+    // Only valid below the count last passed to rank().
+    [[nodiscard]] const RankedMatch &operator[](size_t i) const {
+        return matches[i];
+    }
+
+    Vec<RankedMatch> matches;
+    size_t ranked = 0;
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "./autofill.h"
+#include "./crossword.h"
+#include "./dictionary.h"
+
+using namespace jovial;
+
+// Words a worker tries before adding them to the shared restart budget
+#define PARALLEL_AUTOFILL_FLUSH 64
+
+// Runs Autofill on every core. Each worker has its own Autofill over the same read-only
+// dictionary and searches one subtree at a time. When a worker runs out of subtrees, every
+// busy worker splits the untried half of its shallowest level off into its own deque, where
+// the idle ones steal from the front, so what they steal is as big as it gets. The first
+// fill found stops everyone.
+//
+// Restarts work as in Autofill, only the budget is shared: when it runs out, every worker
+// stops, the bans and slot weights they learned are merged, and all of them start over
+// from the root.
+struct ParallelAutofill {
+    // 0 threads means one per core.
+    explicit ParallelAutofill(int thread_count = 0) {
+        if (thread_count <= 0) {
+            thread_count = (int) std::thread::hardware_concurrency();
+        }
+        worker_count = thread_count > 0 ? thread_count : 1;
+        workers = new Autofill[worker_count];
+        queues = new Queue[worker_count];
+    }
+
+    ParallelAutofill(const ParallelAutofill &) = delete;
+    ParallelAutofill &operator=(const ParallelAutofill &) = delete;
+
+    ~ParallelAutofill() {
+        delete[] workers;
+        delete[] queues;
+    }
+
+    AutofillStatus fill(const Dictionary &dictionary, Crossword &crossword, const std::atomic<bool> *cancel = nullptr) {
+        return fill(dictionary, crossword.slots, crossword.letters, cancel);
+    }
+
+    AutofillStatus fill(const Dictionary &dictionary, Vector2i size, char *letters, const std::atomic<bool> *cancel = nullptr) {
+        SlotTable table;
+        table.build(size, letters);
+        return fill(dictionary, table, letters, cancel);
+    }
+
+    // Same contract as Autofill::fill().
+    AutofillStatus fill(const Dictionary &dictionary, const SlotTable &table, char *letters, const std::atomic<bool> *cancel = nullptr) {
+        this->cancel = cancel;
+        this->letters = letters;
+        nodes = 0;
+        backjumps = 0;
+        restarts = 0;
+        splits = 0;
+        steals = 0;
+
+        AutofillStatus status;
+        bool started = workers[0].start(dictionary, table, letters, &status);
+        failed_slot = workers[0].failed_slot;
+        if (!started) return status;
+        for (int i = 1; i < worker_count; ++i) {
+            workers[i].start(dictionary, table, letters, &status);
+        }
+
+        Vec<uint64_t> bans;
+        Vec<uint32_t> weights;
+        Vec<uint32_t> round_weights;
+        for (uint64_t ban: workers[0].learned_bans()) {
+            bans.push_back(ban);
+        }
+        for (uint32_t weight: workers[0].slot_weights()) {
+            weights.push_back(weight);
+            round_weights.push_back(weight);
+        }
+
+        size_t budget = AUTOFILL_FIRST_RESTART;
+        while (true) {
+            for (int i = 0; i < worker_count; ++i) {
+                workers[i].adopt(bans, weights);
+            }
+            for (size_t s = 0; s < weights.size(); ++s) {
+                round_weights[s] = weights[s];
+            }
+            run_round(budget);
+
+            nodes = 0;
+            backjumps = 0;
+            for (int i = 0; i < worker_count; ++i) {
+                nodes += workers[i].nodes;
+                backjumps += workers[i].backjumps;
+            }
+            if (solved) return AutofillStatus::Filled;
+            if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) return AutofillStatus::Cancelled;
+            if (!out_of_budget.load(std::memory_order_relaxed)) return AutofillStatus::NoFill;
+
+            for (int i = 0; i < worker_count; ++i) {
+                const Vec<uint64_t> &learned = workers[i].learned_bans();
+                for (size_t b = 0; b < bans.size(); ++b) {
+                    bans[b] |= learned[b];
+                }
+                const Vec<uint32_t> &grown = workers[i].slot_weights();
+                for (size_t s = 0; s < weights.size(); ++s) {
+                    weights[s] += grown[s] - round_weights[s];
+                }
+            }
+            restarts += 1;
+            budget += budget / 2;
+        }
+    }
+
+    [[nodiscard]] const Vec<FillSlot> &slots() const {
+        return workers[0].slots;
+    }
+
+    [[nodiscard]] int threads() const {
+        return worker_count;
+    }
+
+    // Statistics of the last fill, over all workers
+    size_t nodes = 0;
+    size_t backjumps = 0;
+    size_t restarts = 0;
+    size_t splits = 0;
+    size_t steals = 0;
+    int failed_slot = -1;
+
+private:
+    // Tasks from `head` on are queued; the owner takes from the back and thieves from the front
+    struct Queue {
+        std::mutex mutex;
+        Vec<FillTask *> tasks;
+        size_t head = 0;
+        std::atomic<int> size = 0;
+    };
+
+    struct Hooks {
+        ParallelAutofill *owner;
+        int worker;
+        size_t counted;
+
+        bool interrupted(size_t nodes) {
+            if (nodes - counted >= PARALLEL_AUTOFILL_FLUSH) {
+                size_t used = owner->used.fetch_add(nodes - counted, std::memory_order_relaxed) + nodes - counted;
+                counted = nodes;
+                if (used >= owner->budget) {
+                    owner->out_of_budget.store(true, std::memory_order_relaxed);
+                    owner->stop.store(true, std::memory_order_relaxed);
+                }
+            }
+            if (owner->cancel != nullptr && owner->cancel->load(std::memory_order_relaxed)) {
+                owner->stop.store(true, std::memory_order_relaxed);
+            }
+            return owner->stop.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] bool hungry() const {
+            return owner->idle.load(std::memory_order_relaxed) > 0 &&
+                   owner->queues[worker].size.load(std::memory_order_relaxed) == 0;
+        }
+
+        void give(FillTask *task) {
+            owner->push(worker, task);
+            owner->splits_made.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    void run_round(size_t round_budget) {
+        budget = round_budget;
+        used.store(0, std::memory_order_relaxed);
+        stop.store(false, std::memory_order_relaxed);
+        idle.store(0, std::memory_order_relaxed);
+        pending.store(0, std::memory_order_relaxed);
+        splits_made.store(0, std::memory_order_relaxed);
+        steals_made.store(0, std::memory_order_relaxed);
+        out_of_budget.store(false, std::memory_order_relaxed);
+        solved = false;
+        push(0, new FillTask);
+
+        Vec<std::thread *> threads;
+        for (int i = 1; i < worker_count; ++i) {
+            threads.push_back(new std::thread([this, i] { work(i); }));
+        }
+        work(0);
+        for (std::thread *thread: threads) {
+            thread->join();
+            delete thread;
+        }
+        // Whatever is still queued after a stop is dropped
+        for (int i = 0; i < worker_count; ++i) {
+            for (size_t t = queues[i].head; t < queues[i].tasks.size(); ++t) {
+                delete queues[i].tasks[t];
+            }
+            queues[i].tasks.clear();
+            queues[i].head = 0;
+            queues[i].size.store(0, std::memory_order_relaxed);
+        }
+        splits += splits_made.load(std::memory_order_relaxed);
+        steals += steals_made.load(std::memory_order_relaxed);
+    }
+
+    void work(int worker) {
+        Autofill &autofill = workers[worker];
+        Hooks hooks{this, worker, autofill.nodes};
+        bool waiting = false;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            FillTask *task = take(worker);
+            if (task == nullptr) {
+                if (!waiting) {
+                    waiting = true;
+                    idle.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (pending.load(std::memory_order_acquire) == 0) break;
+
+                std::unique_lock<std::mutex> lock(wait_mutex);
+                work_ready.wait_for(lock, std::chrono::milliseconds(1));
+                continue;
+            }
+            if (waiting) {
+                waiting = false;
+                idle.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            FillResult result = autofill.run(*task, hooks);
+            delete task;
+            if (result == FillResult::Filled) {
+                {
+                    std::lock_guard<std::mutex> lock(solution_mutex);
+                    if (!solved) {
+                        solved = true;
+                        autofill.write_fill(letters);
+                    }
+                }
+                stop.store(true, std::memory_order_relaxed);
+                autofill.rewind();
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        }
+        if (waiting) {
+            idle.fetch_sub(1, std::memory_order_relaxed);
+        }
+        work_ready.notify_all();
+    }
+
+    void push(int worker, FillTask *task) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(queues[worker].mutex);
+            queues[worker].tasks.push_back(task);
+            queues[worker].size.fetch_add(1, std::memory_order_relaxed);
+        }
+        work_ready.notify_one();
+    }
+
+    // The newest task of its own deque, or else the oldest one of another worker's.
+    FillTask *take(int worker) {
+        {
+            Queue &own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.head < own.tasks.size()) {
+                FillTask *task = own.tasks.back();
+                own.tasks.pop_back();
+                if (own.head == own.tasks.size()) {
+                    own.tasks.clear();
+                    own.head = 0;
+                }
+                own.size.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        for (int i = 1; i < worker_count; ++i) {
+            Queue &other = queues[(worker + i) % worker_count];
+            if (other.size.load(std::memory_order_relaxed) == 0) continue;
+
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (other.head < other.tasks.size()) {
+                FillTask *task = other.tasks[other.head];
+                other.head += 1;
+                if (other.head == other.tasks.size()) {
+                    other.tasks.clear();
+                    other.head = 0;
+                }
+                other.size.fetch_sub(1, std::memory_order_relaxed);
+                steals_made.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    int worker_count = 1;
+    Autofill *workers = nullptr;
+    Queue *queues = nullptr;
+
+    const std::atomic<bool> *cancel = nullptr;
+    char *letters = nullptr;
+
+    // State of the current round
+    size_t budget = 0;
+    std::atomic<size_t> used = 0;
+    std::atomic<bool> stop = false;
+    std::atomic<int> idle = 0;
+    // Tasks queued or running; the round is over when it drops to 0
+    std::atomic<int> pending = 0;
+    std::atomic<size_t> splits_made = 0;
+    std::atomic<size_t> steals_made = 0;
+    std::atomic<bool> out_of_budget = false;
+    bool solved = false;
+    std::mutex solution_mutex;
+
+    std::mutex wait_mutex;
+    std::condition_variable work_ready;
+};
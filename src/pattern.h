@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+
+#define PATTERN_MAX_LEN 256
+
+// Bits 0-25 of a position mask are the letters a-z. Bit 26 stands for every character that
+// isn't a letter, so a class like [^S] also lets the apostrophe in "don't" through.
+#define PATTERN_OTHER_BIT ((uint32_t) 1 << 26)
+#define PATTERN_LETTERS (PATTERN_OTHER_BIT - 1)
+#define PATTERN_ANY (PATTERN_LETTERS | PATTERN_OTHER_BIT)
+
+[[nodiscard]] inline uint32_t pattern_bit(char c) {
+    c = (char) tolower(c);
+    if (c < 'a' || c > 'z') return PATTERN_OTHER_BIT;
+    return (uint32_t) 1 << (c - 'a');
+}
+
+// A search pattern with one set of allowed characters per position, so every search path
+// tests a character with a single AND. Positions that allow exactly one character also keep
+// it in `literals`, which is what tells "'" apart from "-" and what DAWG prefixes are made of.
+// `open_ended` lets the last position start a suffix of any length, like a trailing '*'.
+struct CompiledPattern {
+    uint32_t masks[PATTERN_MAX_LEN] = {};
+    char literals[PATTERN_MAX_LEN] = {};
+    int len = 0;
+    bool open_ended = false;
+
+    // The plain syntax: folded literals, '_' for any character and a trailing '*'. Anything
+    // richer is parsed by the word finder.
+    static CompiledPattern simple(const char *text, int text_len) {
+        CompiledPattern pattern;
+        for (int i = 0; i < text_len && i < PATTERN_MAX_LEN; ++i) {
+            char c = (char) tolower(text[i]);
+            if (c == '_' || c == '*') {
+                pattern.push_any();
+            } else {
+                pattern.push_literal(c);
+            }
+        }
+        pattern.open_ended = pattern.len > 0 && text[pattern.len - 1] == '*';
+        return pattern;
+    }
+
+    bool push_literal(char c) {
+        if (len == PATTERN_MAX_LEN) return false;
+        c = (char) tolower(c);
+        masks[len] = pattern_bit(c);
+        literals[len] = c;
+        len += 1;
+        return true;
+    }
+
+    bool push_mask(uint32_t mask) {
+        if (len == PATTERN_MAX_LEN) return false;
+        len += 1;
+        set_mask(len - 1, mask);
+        return true;
+    }
+
+    // Replaces what an existing position allows.
+    void set_mask(int position, uint32_t mask) {
+        masks[position] = mask;
+        literals[position] = 0;
+        // A class of one letter is the same as that letter
+        if ((mask & PATTERN_OTHER_BIT) == 0 && mask != 0 && (mask & (mask - 1)) == 0) {
+            literals[position] = (char) ('a' + __builtin_ctz(mask));
+        }
+    }
+
+    bool push_any() {
+        return push_mask(PATTERN_ANY);
+    }
+
+    [[nodiscard]] bool allows(int position, char c) const {
+        c = (char) tolower(c);
+        return (masks[position] & pattern_bit(c)) != 0 && (literals[position] == 0 || literals[position] == c);
+    }
+
+    [[nodiscard]] bool is_any(int position) const {
+        return masks[position] == PATTERN_ANY;
+    }
+
+    // Letter classes can be answered from the per-letter posting bitsets; anything that may
+    // match a non-letter needs the words themselves.
+    [[nodiscard]] bool letters_only(int position) const {
+        return (masks[position] & PATTERN_OTHER_BIT) == 0;
+    }
+
+    bool operator==(const CompiledPattern &other) const {
+        if (len != other.len || open_ended != other.open_ended) return false;
+        for (int i = 0; i < len; ++i) {
+            if (masks[i] != other.masks[i] || literals[i] != other.literals[i]) return false;
+        }
+        return true;
+    }
+};
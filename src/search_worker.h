@@ -0,0 +1,228 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "./anagram_index.h"
+#include "./dictionary.h"
+#include "./incremental_search.h"
+#include "./match_results.h"
+#include "./pattern.h"
+
+using namespace jovial;
+
+// Matches are handed over in batches of this many, and at most this many batches per poll
+#define SEARCH_WORKER_BATCH 4096
+#define SEARCH_WORKER_BATCHES_PER_POLL 16
+
+enum class SearchMode {
+    Pattern,
+    Anagram,
+};
+
+// A crossing like {s#ed} at one position of a pattern. Which letters it allows takes a
+// dictionary search of its own, so that is left to the worker.
+struct PatternCrossing {
+    int position = 0;   // in the main pattern
+    int crossing_at = 0;// the '#' square of `crossing`
+    CompiledPattern crossing;
+};
+
+// Everything a search needs, already parsed on the render thread.
+struct SearchRequest {
+    SearchMode mode = SearchMode::Pattern;
+    CompiledPattern pattern;// crossing positions allow anything until the worker narrows them
+    std::vector<PatternCrossing> crossings;
+    AnagramQuery anagram;
+};
+
+// Runs searches on its own thread so that expensive patterns never hold up a frame. Every
+// submit() starts a new generation; the search of an older generation notices it is stale
+// at the next match, or within a few thousand words while filtering or building the anagram
+// index, and gives up. The worker owns the IncrementalSearch, so the cached
+// levels of the previous pattern still make most keystrokes cheap. The anagram index is
+// only built the first time it is needed, also on the worker.
+struct SearchWorker {
+    SearchWorker() = default;
+    SearchWorker(const SearchWorker &) = delete;
+    SearchWorker &operator=(const SearchWorker &) = delete;
+
+    // The dictionary must be ready and outlive the worker.
+    void submit(const Dictionary *dictionary, const SearchRequest &request) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->dictionary = dictionary;
+            requested = request;
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake.notify_one();
+
+        if (!thread.joinable()) {
+            thread = std::thread([this] { run(); });
+        }
+    }
+
+    // Moves matches found since the last poll into `results`, a bounded number per call so a
+    // huge result set streams in over a few frames. The old results are kept until the newest
+    // search has something to show, so the list doesn't flicker while typing. Returns true
+    // when `results` changed.
+    bool poll(MatchResults &results) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (found_generation != generation.load(std::memory_order_relaxed)) return false;
+
+        bool changed = false;
+        if (shown_generation != found_generation) {
+            shown_generation = found_generation;
+            results.clear();
+            changed = true;
+        }
+        if (found_read < found.size()) {
+            size_t count = math::min(found.size() - found_read, (size_t) SEARCH_WORKER_BATCH * SEARCH_WORKER_BATCHES_PER_POLL);
+            results.append(&found[found_read], count);
+            found_read += count;
+            if (found_read == found.size()) {
+                found.clear();
+                found_read = 0;
+            }
+            changed = true;
+        }
+        return changed;
+    }
+
+    // True until every match of the newest search has been polled.
+    [[nodiscard]] bool searching() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return finished_generation != generation.load(std::memory_order_relaxed) || found_read < found.size();
+    }
+
+    ~SearchWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            // Also a new generation, so a search still running gives up instead of finishing
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+private:
+    void run() {
+        SearchRequest request;
+        Vec<RankedMatch> batch;
+
+        while (true) {
+            uint32_t current;
+            const Dictionary *dict;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] {
+                    return stopping || started_generation != generation.load(std::memory_order_relaxed);
+                });
+                if (stopping) return;
+
+                current = generation.load(std::memory_order_relaxed);
+                started_generation = current;
+                request = requested;
+                dict = dictionary;
+            }
+
+            batch.clear();
+            bool cancelled = false;
+            auto stopped = [&] {
+                cancelled = cancelled || generation.load(std::memory_order_relaxed) != current;
+                return cancelled;
+            };
+            auto collect = [&](uint32_t id) {
+                if (stopped()) return false;
+                batch.push_back({dict->scores[id], id});
+                if (batch.size() == SEARCH_WORKER_BATCH) {
+                    cancelled = !publish(current, batch, false);
+                    batch.clear();
+                }
+                return !cancelled;
+            };
+
+            if (request.mode == SearchMode::Anagram) {
+                if (anagrams.is_built() || anagrams.build(*dict, stopped)) {
+                    anagrams.query(*dict, request.anagram, collect, stopped);
+                }
+            } else {
+                narrow_crossings(*dict, request, stopped);
+                if (!cancelled) {
+                    search.sync(*dict, request.pattern, stopped);
+                }
+                if (!cancelled) {
+                    search.for_each_match(*dict, collect, stopped);
+                }
+            }
+            if (!cancelled) {
+                publish(current, batch, true);
+            }
+        }
+    }
+
+    // Narrows each crossing position of the pattern to the letters its crossing entry can
+    // have there.
+    template<typename S>
+    static void narrow_crossings(const Dictionary &dict, SearchRequest &request, S &&stopped) {
+        for (const PatternCrossing &crossing: request.crossings) {
+            uint32_t mask = 0;
+            dict.query(crossing.crossing, [&](StringView crossing_word) {
+                mask |= pattern_bit(crossing_word[crossing.crossing_at]);
+                return mask != PATTERN_ANY && !stopped();
+            });
+            if (stopped()) return;
+            request.pattern.set_mask(crossing.position, mask);
+        }
+    }
+
+    // Returns false once `current` has been superseded.
+    bool publish(uint32_t current, const Vec<RankedMatch> &batch, bool finished) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (generation.load(std::memory_order_relaxed) != current) return false;
+
+        if (found_generation != current) {
+            found_generation = current;
+            found.clear();
+            found_read = 0;
+        }
+        for (const RankedMatch &match: batch) {
+            found.push_back(match);
+        }
+        if (finished) {
+            finished_generation = current;
+        }
+        return true;
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+    bool stopping = false;
+
+    // Written under the mutex, but also read without it by the worker to notice cancellation
+    std::atomic<uint32_t> generation = 0;
+
+    const Dictionary *dictionary = nullptr;
+    SearchRequest requested;
+
+    uint32_t started_generation = 0;
+    uint32_t found_generation = 0;
+    uint32_t finished_generation = 0;
+    uint32_t shown_generation = 0;
+    Vec<RankedMatch> found;
+    size_t found_read = 0;
+
+    // Only touched by the worker thread
+    IncrementalSearch search;
+    AnagramIndex anagrams;
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "./grid_tiles.h"
+#include "./shareword_parser.h"
+
+using namespace jovial;
+
+// Version 2 of the puzzle format, for archives: a fixed header, the grid packed 5 bits to
+// a square, a table of fixed size clue records, and the hints they point into with every
+// distinct hint stored once. Nothing needs parsing, so a mapped file can be read in place.
+// The sections are copied in and out with memcpy, so numbers are in the host's byte
+// order, which is little endian everywhere this runs.
+//
+//     ShareWordHeader | grid | ShareWordClueRecord across..., down... | hints
+
+#define SHAREWORD_BINARY_VERSION 2
+#define SHAREWORD_BINARY_EXTENSION ".swb"
+
+// Starts with a byte no title can, so text files are never mistaken for binary ones
+static const char SHAREWORD_BINARY_MAGIC[4] = {'\x7f', 'S', 'W', 'B'};
+
+enum class ShareWordFormat {
+    Text,
+    Binary,
+};
+
+// Puzzles are saved as binary when the name ends in SHAREWORD_BINARY_EXTENSION
+[[nodiscard]] inline ShareWordFormat shareword_format_for(const char *path, size_t len) {
+    size_t extension = sizeof(SHAREWORD_BINARY_EXTENSION) - 1;
+    if (len >= extension && memcmp(path + len - extension, SHAREWORD_BINARY_EXTENSION, extension) == 0) {
+        return ShareWordFormat::Binary;
+    }
+    return ShareWordFormat::Text;
+}
+
+enum class ShareWordGrid : uint32_t {
+    Packed,// 5 bits a square, see shareword_cell_code()
+    Raw,   // a byte a square, for grids with squares the packing has no code for
+    Tiled, // a mask of the GRID_TILE_SIZE tiles that aren't all blocks, then their squares packed
+};
+
+struct ShareWordHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint32_t grid_encoding;
+    uint32_t grid_offset;
+    uint32_t grid_bytes;
+    uint32_t across_count;
+    uint32_t down_count;
+    uint32_t clues_offset;
+    uint32_t hints_offset;
+    uint32_t hints_bytes;
+    char title[32];
+};
+static_assert(sizeof(ShareWordHeader) == 80, "the header is part of the file format");
+
+// Hint lengths fit in 6 bits, which leaves 26 for the offset into the hints section
+#define SHAREWORD_BINARY_HINT_LEN_BITS 6
+#define SHAREWORD_BINARY_MAX_HINTS_BYTES (1u << (32 - SHAREWORD_BINARY_HINT_LEN_BITS))
+#define SHAREWORD_BINARY_MAX_SIDE UINT16_MAX
+
+struct ShareWordClueRecord {
+    uint32_t number;
+    uint16_t x;
+    uint16_t y;
+    uint32_t hint;// offset << SHAREWORD_BINARY_HINT_LEN_BITS | length
+};
+static_assert(sizeof(ShareWordClueRecord) == 12, "clue records are part of the file format");
+static_assert(SHAREWORD_MAX_HINT_LEN < (1 << SHAREWORD_BINARY_HINT_LEN_BITS), "hint lengths have to fit their bits");
+
+// A clue as stored, with the hint still in the file and not terminated.
+struct ShareWordClue {
+    int number;
+    Vector2i coords;
+    const char *hint;
+    int len;
+};
+
+// 0 is a block, 1 to 26 the letters A to Z, 27 a '.' and 28 a ' '. Returns -1 for the
+// squares that need the raw encoding.
+[[nodiscard]] inline int shareword_cell_code(char c) {
+    if (c == '\0') return 0;
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 1;
+    if (c == '.') return 27;
+    if (c == ' ') return 28;
+    return -1;
+}
+
+[[nodiscard]] inline size_t shareword_packed_bytes(size_t cells) {
+    return (cells * 5 + 7) / 8;
+}
+
+// One bit per tile, set for the tiles that are stored
+[[nodiscard]] inline size_t shareword_tile_mask_bytes(size_t tiles) {
+    return (tiles + 7) / 8;
+}
+
+// Squares written 5 bits at a time, lowest bits first.
+struct ShareWordCellWriter {
+    void push(int code) {
+        bits |= (uint64_t) code << bit_count;
+        bit_count += 5;
+        while (bit_count >= 8) {
+            out->push_back((char) (bits & 0xff));
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    }
+
+    void finish() {
+        if (bit_count > 0) {
+            out->push_back((char) bits);
+        }
+        bits = 0;
+        bit_count = 0;
+    }
+
+    std::vector<char> *out;
+    uint64_t bits = 0;
+    int bit_count = 0;
+};
+
+struct ShareWordCellReader {
+    int next() {
+        if (bit_count < 5) {
+            bits |= (uint64_t) *bytes++ << bit_count;
+            bit_count += 8;
+        }
+        int code = (int) (bits & 31);
+        bits >>= 5;
+        bit_count -= 5;
+        return code;
+    }
+
+    const uint8_t *bytes;
+    uint64_t bits = 0;
+    int bit_count = 0;
+};
+
+// Appends the grid in the smallest encoding that keeps every square and returns which:
+// tiled when enough GRID_TILE_SIZE tiles are all blocks to pay for the tile mask, packed
+// otherwise, and raw if some square has no code.
+inline ShareWordGrid shareword_pack_grid(Vector2i size, const char *letters, std::vector<char> *out) {
+    size_t cells = (size_t) size.x * size.y;
+    for (size_t i = 0; i < cells; ++i) {
+        if (shareword_cell_code(letters[i]) == -1) {
+            out->insert(out->end(), letters, letters + cells);
+            return ShareWordGrid::Raw;
+        }
+    }
+
+    GridTiles tiles;
+    tiles.build(size, letters);
+    size_t open_cells = 0;
+    for (int tile = 0; tile < tiles.tile_count(); ++tile) {
+        Vector2i extent = tiles.extent(tile);
+        open_cells += tiles.all_blocks(tile) ? 0 : (size_t) extent.x * extent.y;
+    }
+
+    ShareWordCellWriter writer{out};
+    if (shareword_tile_mask_bytes(tiles.tile_count()) + shareword_packed_bytes(open_cells) >= shareword_packed_bytes(cells)) {
+        for (size_t i = 0; i < cells; ++i) {
+            writer.push(shareword_cell_code(letters[i]));
+        }
+        writer.finish();
+        return ShareWordGrid::Packed;
+    }
+
+    size_t mask = out->size();
+    out->resize(mask + shareword_tile_mask_bytes(tiles.tile_count()), 0);
+    for (int tile = 0; tile < tiles.tile_count(); ++tile) {
+        if (tiles.all_blocks(tile)) continue;
+
+        (*out)[mask + tile / 8] |= (char) (1 << (tile % 8));
+        Vector2i first = tiles.start(tile);
+        Vector2i extent = tiles.extent(tile);
+        for (int y = first.y; y < first.y + extent.y; ++y) {
+            for (int x = first.x; x < first.x + extent.x; ++x) {
+                writer.push(shareword_cell_code(letters[(size_t) y * size.x + x]));
+            }
+        }
+    }
+    writer.finish();
+    return ShareWordGrid::Tiled;
+}
+
+// Hands out offsets into the hints section, giving repeated hints the offset of the first.
+// The views point into the caller's hints, which have to outlive the pool.
+struct ShareWordHintPool {
+    uint32_t add(const char *hint, size_t len) {
+        std::string_view text(hint, len);
+        auto found = offsets.find(text);
+        if (found != offsets.end()) return found->second;
+
+        auto offset = (uint32_t) bytes.size();
+        bytes.insert(bytes.end(), hint, hint + len);
+        offsets.emplace(text, offset);
+        return offset;
+    }
+
+    std::vector<char> bytes;
+    std::unordered_map<std::string_view, uint32_t> offsets;
+};
+
+// Read-only view of a binary puzzle in memory. open() checks the header and that every
+// section fits the buffer, but clues are only read, and checked, when asked for.
+struct ShareWordBinary {
+    [[nodiscard]] static bool detect(const char *data, size_t size) {
+        return size >= sizeof(SHAREWORD_BINARY_MAGIC) && memcmp(data, SHAREWORD_BINARY_MAGIC, sizeof(SHAREWORD_BINARY_MAGIC)) == 0;
+    }
+
+    // Errors give the byte offset of the bad field as the column, on line 0
+    ShareWordParse open(const char *file_data, size_t file_size) {
+        data = file_data;
+        size = file_size;
+
+        auto fail = [](ShareWordError error, size_t at) {
+            ShareWordParse parse;
+            parse.error = error;
+            parse.column = (int) at;
+            return parse;
+        };
+        if (!detect(data, size) || size < sizeof(ShareWordHeader)) return fail(ShareWordError::Truncated, size);
+        memcpy(&header, data, sizeof(header));
+
+        if (header.version != SHAREWORD_BINARY_VERSION) return fail(ShareWordError::UnsupportedVersion, offsetof(ShareWordHeader, version));
+        if (header.width <= 0 || header.height <= 0 || header.width > SHAREWORD_BINARY_MAX_SIDE || header.height > SHAREWORD_BINARY_MAX_SIDE) return fail(ShareWordError::BadSize, offsetof(ShareWordHeader, width));
+        if ((uint64_t) header.width * (uint64_t) header.height > SHAREWORD_MAX_SQUARES) return fail(ShareWordError::TooLarge, offsetof(ShareWordHeader, width));
+        if (memchr(header.title, '\0', SHAREWORD_MAX_TITLE_LEN + 1) == nullptr) {
+            return fail(ShareWordError::TitleTooLong, offsetof(ShareWordHeader, title));
+        }
+
+        if (!fits(header.grid_offset, header.grid_bytes)) return fail(ShareWordError::Truncated, offsetof(ShareWordHeader, grid_offset));
+        if (header.grid_bytes != grid_bytes()) return fail(ShareWordError::BadGrid, offsetof(ShareWordHeader, grid_encoding));
+
+        uint64_t clue_bytes = ((uint64_t) header.across_count + header.down_count) * sizeof(ShareWordClueRecord);
+        if (!fits(header.clues_offset, clue_bytes)) return fail(ShareWordError::Truncated, offsetof(ShareWordHeader, clues_offset));
+        if (!fits(header.hints_offset, header.hints_bytes)) return fail(ShareWordError::Truncated, offsetof(ShareWordHeader, hints_offset));
+        return {};
+    }
+
+    [[nodiscard]] Vector2i grid_size() const {
+        return {header.width, header.height};
+    }
+
+    // Writes the squares the way Crossword keeps them, '\0' for a block. Returns false at a
+    // square with no code.
+    bool decode_grid(char *letters) const {
+        const auto *grid = (const uint8_t *) data + header.grid_offset;
+        size_t cells = (size_t) header.width * header.height;
+        if (header.grid_encoding == (uint32_t) ShareWordGrid::Raw) {
+            memcpy(letters, grid, cells);
+            return true;
+        }
+        if (header.grid_encoding == (uint32_t) ShareWordGrid::Packed) {
+            ShareWordCellReader reader{grid};
+            for (size_t i = 0; i < cells; ++i) {
+                if (!decode_cell(reader.next(), letters + i)) return false;
+            }
+            return true;
+        }
+
+        GridTiles tiles;
+        tiles.resize(grid_size());
+        memset(letters, 0, cells);
+        ShareWordCellReader reader{grid + shareword_tile_mask_bytes(tiles.tile_count())};
+        for (int tile = 0; tile < tiles.tile_count(); ++tile) {
+            if ((grid[tile / 8] & (1 << (tile % 8))) == 0) continue;
+
+            Vector2i first = tiles.start(tile);
+            Vector2i extent = tiles.extent(tile);
+            for (int y = first.y; y < first.y + extent.y; ++y) {
+                for (int x = first.x; x < first.x + extent.x; ++x) {
+                    if (!decode_cell(reader.next(), letters + (size_t) y * header.width + x)) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] size_t clue_count(bool across) const {
+        return across ? header.across_count : header.down_count;
+    }
+
+    // Returns false if the clue's hint is outside the hints section or too long
+    bool clue(bool across, size_t i, ShareWordClue *out) const {
+        ShareWordClueRecord record{};
+        memcpy(&record, data + clue_offset(across, i), sizeof(record));
+        uint32_t offset = record.hint >> SHAREWORD_BINARY_HINT_LEN_BITS;
+        uint32_t len = record.hint & ((1u << SHAREWORD_BINARY_HINT_LEN_BITS) - 1);
+        if (record.number > INT32_MAX || len > SHAREWORD_MAX_HINT_LEN || (uint64_t) offset + len > header.hints_bytes) {
+            return false;
+        }
+        out->number = (int) record.number;
+        out->coords = {record.x, record.y};
+        out->hint = data + header.hints_offset + offset;
+        out->len = (int) len;
+        return true;
+    }
+
+    // Where clue `i` is in the file, for error messages
+    [[nodiscard]] size_t clue_offset(bool across, size_t i) const {
+        return header.clues_offset + (across ? i : header.across_count + i) * sizeof(ShareWordClueRecord);
+    }
+
+    ShareWordHeader header{};
+    const char *data = nullptr;
+    size_t size = 0;
+
+private:
+    // What the grid section should take for the header's size and encoding, or 0 if the
+    // encoding is unknown. Reads the tile mask, so the section has to fit the buffer.
+    [[nodiscard]] uint64_t grid_bytes() const {
+        uint64_t cells = (uint64_t) header.width * (uint64_t) header.height;
+        switch ((ShareWordGrid) header.grid_encoding) {
+            case ShareWordGrid::Packed:
+                return shareword_packed_bytes(cells);
+            case ShareWordGrid::Raw:
+                return cells;
+            case ShareWordGrid::Tiled: {
+                GridTiles tiles;
+                tiles.resize(grid_size());
+                size_t mask_bytes = shareword_tile_mask_bytes(tiles.tile_count());
+                if (header.grid_bytes < mask_bytes) return 0;
+
+                const auto *mask = (const uint8_t *) data + header.grid_offset;
+                uint64_t stored = 0;
+                for (int tile = 0; tile < tiles.tile_count(); ++tile) {
+                    if (mask[tile / 8] & (1 << (tile % 8))) {
+                        Vector2i extent = tiles.extent(tile);
+                        stored += (uint64_t) extent.x * extent.y;
+                    }
+                }
+                return mask_bytes + shareword_packed_bytes(stored);
+            }
+        }
+        return 0;
+    }
+
+    static bool decode_cell(int code, char *letter) {
+        static const char CODES[29] = {
+                '\0', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O',
+                'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', '.', ' '};
+        if (code > 28) return false;
+        *letter = CODES[code];
+        return true;
+    }
+
+    [[nodiscard]] bool fits(uint64_t offset, uint64_t bytes) const {
+        return offset <= size && bytes <= size - offset;
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace jovial;
+
+// Longest title and hint a puzzle can hold, not counting the terminating '\0'
+#define SHAREWORD_MAX_TITLE_LEN 29
+#define SHAREWORD_MAX_HINT_LEN 63
+// Most squares a grid can have, 16384 by 16384, so that square indices and counts stay well
+// inside an int and a bad size line can't ask for more than 256 MB
+#define SHAREWORD_MAX_SQUARES (1 << 28)
+
+enum class ShareWordError {
+    None,
+    Empty,
+    TitleTooLong,
+    BadSize,
+    GridTooShort,
+    MissingAcross,
+    BadClue,
+    HintTooLong,
+    UnsupportedVersion,
+    BadGrid,
+    Truncated,
+    TooLarge,
+};
+
+[[nodiscard]] inline const char *shareword_error_text(ShareWordError error) {
+    switch (error) {
+        case ShareWordError::None:
+            return "No error";
+        case ShareWordError::Empty:
+            return "The file is empty";
+        case ShareWordError::TitleTooLong:
+            return "The title is too long";
+        case ShareWordError::BadSize:
+            return "Expected the width and height of the grid";
+        case ShareWordError::GridTooShort:
+            return "The file ends before the grid does";
+        case ShareWordError::MissingAcross:
+            return "Expected 'across:' after the grid";
+        case ShareWordError::BadClue:
+            return "Expected a clue as number:x,y:hint";
+        case ShareWordError::HintTooLong:
+            return "The hint is too long";
+        case ShareWordError::UnsupportedVersion:
+            return "The file was written by a newer version";
+        case ShareWordError::BadGrid:
+            return "The grid is not stored in a known way";
+        case ShareWordError::Truncated:
+            return "The file ends in the middle of a section";
+        case ShareWordError::TooLarge:
+            return "The grid is too large";
+    }
+    return "";
+}
+
+// Where parsing stopped, counting lines and columns from 1. Binary files have no lines,
+// so their errors are on line 0 with the byte offset as the column.
+struct ShareWordParse {
+    ShareWordError error = ShareWordError::None;
+    int line = 0;
+    int column = 0;
+
+    [[nodiscard]] bool ok() const {
+        return error == ShareWordError::None;
+    }
+};
+
+// Reads the text format in one pass straight out of `data`, which is usually a mapped
+// file. Nothing is copied or allocated here; the parts are handed to the sink as pointers
+// into `data`, in file order:
+//
+//     sink.title(const char *text, int len)
+//     sink.grid(Vector2i size, const char *cells)      size.x * size.y cells, '~' a block
+//     sink.clue(bool across, int number, Vector2i coords, const char *hint, int len)
+//
+// The format is the title line, a "width height" line, the cells with no line breaks,
+// then an "across:" line and a "number:x,y:hint" line per clue, and the same after a
+// "down:" line. Blank lines and '\r' before a line break are allowed. On an error the sink
+// may have seen some of the parts already.
+template<typename Sink>
+ShareWordParse parse_shareword(const char *data, size_t size, Sink &sink) {
+    ShareWordParse parse;
+    size_t pos = 0;
+    size_t line_start = 0;
+    int line = 1;
+
+    auto fail = [&](ShareWordError error, size_t at) {
+        parse.error = error;
+        parse.line = line;
+        parse.column = (int) (at - line_start) + 1;
+        return parse;
+    };
+    // The end of the line at `pos`, without its '\r'
+    auto line_end = [&]() {
+        const char *newline = (const char *) memchr(data + pos, '\n', size - pos);
+        size_t end = newline == nullptr ? size : (size_t) (newline - data);
+        return end > pos && data[end - 1] == '\r' ? end - 1 : end;
+    };
+    auto next_line = [&]() {
+        const char *newline = (const char *) memchr(data + pos, '\n', size - pos);
+        pos = newline == nullptr ? size : (size_t) (newline - data) + 1;
+        line_start = pos;
+        line += 1;
+    };
+    // A decimal number that fits an int, which leaves `at` on the first character after it
+    auto number = [&](size_t *at, size_t end, int *value) {
+        size_t start = *at;
+        int64_t result = 0;
+        while (*at < end && data[*at] >= '0' && data[*at] <= '9') {
+            if (result <= INT32_MAX) {
+                result = result * 10 + (data[*at] - '0');
+            }
+            *at += 1;
+        }
+        *value = (int) result;
+        return *at > start && result <= INT32_MAX;
+    };
+    // Steps over `c`, or leaves `at` on whatever is there instead
+    auto separator = [&](size_t *at, size_t end, char c) {
+        if (*at == end || data[*at] != c) return false;
+        *at += 1;
+        return true;
+    };
+
+    if (size == 0) return fail(ShareWordError::Empty, 0);
+
+    size_t end = line_end();
+    if (end - pos > SHAREWORD_MAX_TITLE_LEN) return fail(ShareWordError::TitleTooLong, pos + SHAREWORD_MAX_TITLE_LEN);
+    sink.title(data + pos, (int) (end - pos));
+    next_line();
+
+    end = line_end();
+    Vector2i grid_size;
+    size_t at = pos;
+    if (!number(&at, end, &grid_size.x) || at == end || data[at] != ' ') return fail(ShareWordError::BadSize, at);
+    while (at < end && data[at] == ' ') {
+        at += 1;
+    }
+    if (!number(&at, end, &grid_size.y)) return fail(ShareWordError::BadSize, at);
+    while (at < end && data[at] == ' ') {
+        at += 1;
+    }
+    if (at != end || grid_size.x <= 0 || grid_size.y <= 0) return fail(ShareWordError::BadSize, at);
+    uint64_t cells = (uint64_t) grid_size.x * (uint64_t) grid_size.y;
+    if (cells > SHAREWORD_MAX_SQUARES) return fail(ShareWordError::TooLarge, pos);
+    next_line();
+
+    if (cells > size - pos) return fail(ShareWordError::GridTooShort, size);
+    sink.grid(grid_size, data + pos);
+    pos += cells;
+
+    // Files written by hand may break the line after the grid
+    if (pos < size && data[pos] == '\r') {
+        pos += 1;
+    }
+    if (pos < size && data[pos] == '\n') {
+        pos += 1;
+        line_start = pos;
+        line += 1;
+    }
+    end = line_end();
+    if (end - pos != 7 || memcmp(data + pos, "across:", 7) != 0) return fail(ShareWordError::MissingAcross, pos);
+    next_line();
+
+    bool across = true;
+    while (pos < size) {
+        end = line_end();
+        if (end == pos) {
+            next_line();
+            continue;
+        }
+        if (across && end - pos == 5 && memcmp(data + pos, "down:", 5) == 0) {
+            across = false;
+            next_line();
+            continue;
+        }
+
+        int clue_number;
+        Vector2i coords;
+        at = pos;
+        if (!number(&at, end, &clue_number) || !separator(&at, end, ':')) return fail(ShareWordError::BadClue, at);
+        if (!number(&at, end, &coords.x) || !separator(&at, end, ',')) return fail(ShareWordError::BadClue, at);
+        if (!number(&at, end, &coords.y) || !separator(&at, end, ':')) return fail(ShareWordError::BadClue, at);
+        if (end - at > SHAREWORD_MAX_HINT_LEN) return fail(ShareWordError::HintTooLong, at + SHAREWORD_MAX_HINT_LEN);
+
+        sink.clue(across, clue_number, coords, data + at, (int) (end - at));
+        next_line();
+    }
+    return parse;
+}
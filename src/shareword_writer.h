@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Jovial/FileSystem/FileSystem.h"
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector2i.h"
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "./mapped_file.h"
+#include "./shareword_binary.h"
+#include "./shareword_parser.h"
+
+using namespace jovial;
+
+// Bytes of a file being written. Sized once up front and kept between saves, so writing a
+// puzzle is a run of memcpys rather than a string allocation per field.
+struct ShareWordBuffer {
+    void clear() {
+        bytes.clear();
+    }
+
+    void reserve(size_t size) {
+        bytes.reserve(size);
+    }
+
+    void append(const char *data, size_t len) {
+        bytes.insert(bytes.end(), data, data + len);
+    }
+
+    void append(char c) {
+        bytes.push_back(c);
+    }
+
+    void append_number(int64_t number) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        append(digits, (size_t) (result.ptr - digits));
+    }
+
+    std::vector<char> bytes;
+};
+
+// Appends one clue list of the text format, see parse_shareword()
+template<typename Answers>
+void write_shareword_clues(const Answers &answers, ShareWordBuffer *out) {
+    for (const auto &answer: answers) {
+        out->append_number(answer.number);
+        out->append(':');
+        out->append_number(answer.coords.x);
+        out->append(',');
+        out->append_number(answer.coords.y);
+        out->append(':');
+        out->append(answer.hint, strnlen(answer.hint, SHAREWORD_MAX_HINT_LEN));
+        out->append('\n');
+    }
+}
+
+// Appends a puzzle in the text format. `Answers` is a list of anything with a number,
+// coords and a terminated hint.
+template<typename Answers>
+void write_shareword_text(const char *title, Vector2i size, const char *letters, const Answers &across, const Answers &down,
+                          ShareWordBuffer *out) {
+    size_t cells = (size_t) size.x * size.y;
+    size_t title_len = strnlen(title, SHAREWORD_MAX_TITLE_LEN);
+    size_t estimate = title_len + 24 + cells + 16;
+    for (const Answers *answers: {&across, &down}) {
+        for (const auto &answer: *answers) {
+            estimate += 36 + strnlen(answer.hint, SHAREWORD_MAX_HINT_LEN);
+        }
+    }
+    out->reserve(out->bytes.size() + estimate);
+
+    out->append(title, title_len);
+    out->append('\n');
+    out->append_number(size.x);
+    out->append(' ');
+    out->append_number(size.y);
+    out->append('\n');
+
+    size_t start = out->bytes.size();
+    out->append(letters, cells);
+    char *grid = out->bytes.data() + start;
+    for (size_t i = 0; i < cells; ++i) {
+        if (grid[i] == '\0') {
+            grid[i] = '~';
+        }
+    }
+
+    out->append("across:\n", 8);
+    write_shareword_clues(across, out);
+    out->append("down:\n", 6);
+    write_shareword_clues(down, out);
+}
+
+// Appends a puzzle in the binary format. Returns false, with `out` as it was, if the grid
+// is wider than 16 bit coordinates, has more than SHAREWORD_MAX_SQUARES squares, or the hints
+// are longer than 26 bit offsets allow.
+template<typename Answers>
+bool write_shareword_binary(const char *title, Vector2i size, const char *letters, const Answers &across, const Answers &down,
+                            ShareWordBuffer *out) {
+    if (size.x > SHAREWORD_BINARY_MAX_SIDE || size.y > SHAREWORD_BINARY_MAX_SIDE) return false;
+    if ((uint64_t) size.x * (uint64_t) size.y > SHAREWORD_MAX_SQUARES) return false;
+
+    std::vector<char> &output = out->bytes;
+    size_t start = output.size();
+    size_t cells = (size_t) size.x * size.y;
+    size_t clue_count = across.size() + down.size();
+    out->reserve(start + sizeof(ShareWordHeader) + cells + 4 + clue_count * (sizeof(ShareWordClueRecord) + SHAREWORD_MAX_HINT_LEN));
+
+    ShareWordHeader header{};
+    memcpy(header.magic, SHAREWORD_BINARY_MAGIC, sizeof(header.magic));
+    header.version = SHAREWORD_BINARY_VERSION;
+    header.width = size.x;
+    header.height = size.y;
+    strncpy(header.title, title, SHAREWORD_MAX_TITLE_LEN);
+
+    output.resize(start + sizeof(header));
+    header.grid_offset = (uint32_t) (output.size() - start);
+    header.grid_encoding = (uint32_t) shareword_pack_grid(size, letters, &output);
+    header.grid_bytes = (uint32_t) (output.size() - start - header.grid_offset);
+    output.resize(start + ((output.size() - start + 3) & ~(size_t) 3));
+
+    ShareWordHintPool hints;
+    header.across_count = (uint32_t) across.size();
+    header.down_count = (uint32_t) down.size();
+    header.clues_offset = (uint32_t) (output.size() - start);
+    for (const Answers *answers: {&across, &down}) {
+        for (const auto &answer: *answers) {
+            size_t len = strnlen(answer.hint, SHAREWORD_MAX_HINT_LEN);
+            uint32_t hint = hints.add(answer.hint, len) << SHAREWORD_BINARY_HINT_LEN_BITS | (uint32_t) len;
+            ShareWordClueRecord record{(uint32_t) answer.number, (uint16_t) answer.coords.x, (uint16_t) answer.coords.y, hint};
+            out->append((const char *) &record, sizeof(record));
+        }
+    }
+    if (hints.bytes.size() >= SHAREWORD_BINARY_MAX_HINTS_BYTES) {
+        output.resize(start);
+        return false;
+    }
+    header.hints_offset = (uint32_t) (output.size() - start);
+    header.hints_bytes = (uint32_t) hints.bytes.size();
+    out->append(hints.bytes.data(), hints.bytes.size());
+    memcpy(output.data() + start, &header, sizeof(header));
+    return true;
+}
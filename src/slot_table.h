@@ -0,0 +1,272 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cstdint>
+
+#include "./grid_tiles.h"
+
+using namespace jovial;
+
+// Runs shorter than this aren't words
+#define SLOT_MIN_LEN 2
+// Edits logged before the log starts over
+#define SLOT_TABLE_MAX_EDITS 4096
+
+// One across or down run of at least SLOT_MIN_LEN open cells. A freed slot has len 0.
+struct Slot {
+    Vector2i start;
+    bool across = true;
+    int len = 0;
+};
+
+// Every across and down run of the grid, and for each cell the runs it is part of, which
+// links every cell of a run to the run crossing it there. '\0' is a block and anything
+// else is open.
+//
+// Slot ids stay put while the grid is edited: update() only rescans the row and column of
+// the cell that changed, frees the runs that were there and reuses their ids for the new
+// ones, so nothing else in the table moves.
+//
+// Every slot that is added or has a cell edited is appended to `edits`, so whatever is
+// derived from the slots can catch up on just those.
+//
+// `numbers` holds the standard crossword numbering. update() only notes which cells it
+// may have moved; renumber() numbers those again and shifts the numbers after them.
+struct SlotTable {
+    void build(Vector2i size, const char *letters) {
+        this->size = size;
+        generation += 1;
+        edits.clear();
+        slots.clear();
+        free_slots.clear();
+        across_at.clear();
+        down_at.clear();
+        numbers.clear();
+        starts.clear();
+        for (int i = 0; i < size.x * size.y; ++i) {
+            across_at.push_back(-1);
+            down_at.push_back(-1);
+            numbers.push_back(0);
+            starts.push_back(0);
+        }
+        for (int y = 0; y < size.y; ++y) {
+            scan(letters, true, y, 0, size.x - 1);
+        }
+        for (int x = 0; x < size.x; ++x) {
+            scan(letters, false, x, 0, size.y - 1);
+        }
+        tiles.build(size, letters);
+        number_from = 0;
+        number_to = size.x * size.y - 1;
+        renumber([](int, int) {});
+    }
+
+    // Call after `coord` turned from a block into an open cell or back.
+    void update(const char *letters, Vector2i coord) {
+        relink(letters, true, coord.y, coord.x);
+        relink(letters, false, coord.x, coord.y);
+        tiles.update(letters, coord);
+
+        // Only the cell and the ones after it and below it can start or stop starting a
+        // word, and the one before it or above it if its run was two long
+        int first = coord.y > 0 ? index(true, coord.y - 1, coord.x) : index(true, coord.y, math::max(coord.x - 1, 0));
+        int last = coord.y < size.y - 1 ? index(true, coord.y + 1, coord.x) : index(true, coord.y, math::min(coord.x + 1, size.x - 1));
+        number_from = math::min(number_from, first);
+        number_to = math::max(number_to, last);
+    }
+
+    // Brings `numbers` up to date after update()s, calling `changed(cell, number)` for
+    // every cell whose number, or which of its runs start on it, is now different.
+    template<typename F>
+    void renumber(F &&changed) {
+        if (number_to < number_from) return;
+
+        int next = 1;
+        for (int i = number_from - 1; i >= 0; --i) {
+            if (numbers[i] != 0) {
+                next = numbers[i] + 1;
+                break;
+            }
+        }
+        int cells = size.x * size.y;
+        int i = number_from;
+        for (; i <= number_to; ++i) {
+            Vector2i coord(i % size.x, i / size.x);
+            auto runs = (uint8_t) (starts_run(true, coord) | starts_run(false, coord) << 1);
+            int number = runs != 0 ? next++ : 0;
+            if (number != numbers[i] || runs != starts[i]) {
+                numbers[i] = number;
+                starts[i] = runs;
+                changed(i, number);
+            }
+        }
+        // Past the cells that changed the same cells start words, so the rest only move by
+        // however many words were added or taken away before them
+        while (i < cells && numbers[i] == 0) {
+            i += 1;
+        }
+        int shift = i < cells ? next - numbers[i] : 0;
+        if (shift != 0) {
+            for (; i < cells; ++i) {
+                if (numbers[i] != 0) {
+                    numbers[i] += shift;
+                    changed(i, numbers[i]);
+                }
+            }
+        }
+        number_from = INT32_MAX;
+        number_to = -1;
+    }
+
+    // Call after the letter at `coord` changed.
+    void touch(Vector2i coord) {
+        tiles.touch(coord);
+        int a = across_slot(coord);
+        int d = down_slot(coord);
+        if (a != -1) {
+            log_edit(a);
+        }
+        if (d != -1) {
+            log_edit(d);
+        }
+    }
+
+    [[nodiscard]] int cell(int slot, int p) const {
+        const Slot &s = slots[slot];
+        return s.across ? s.start.y * size.x + s.start.x + p : (s.start.y + p) * size.x + s.start.x;
+    }
+
+    // The run crossing `slot` at its p-th cell, or -1
+    [[nodiscard]] int crossing(int slot, int p) const {
+        return (slots[slot].across ? down_at : across_at)[cell(slot, p)];
+    }
+
+    [[nodiscard]] int across_slot(Vector2i coord) const {
+        return across_at[coord.y * size.x + coord.x];
+    }
+
+    [[nodiscard]] int down_slot(Vector2i coord) const {
+        return down_at[coord.y * size.x + coord.x];
+    }
+
+    [[nodiscard]] bool starts_run(bool across, Vector2i coord) const {
+        int slot = across ? across_slot(coord) : down_slot(coord);
+        return slot != -1 && slots[slot].start == coord;
+    }
+
+    [[nodiscard]] bool starts_word(Vector2i coord) const {
+        return starts_run(true, coord) || starts_run(false, coord);
+    }
+
+    // The number of the word starting at `coord` as of the last renumber(), or 0
+    [[nodiscard]] int number(Vector2i coord) const {
+        return numbers[coord.y * size.x + coord.x];
+    }
+
+    Vector2i size;
+    // Indexed by slot id; skip the ones with len 0
+    Vec<Slot> slots;
+
+    // Slot ids in the order they were edited. Ids may repeat or have been freed since.
+    Vec<int> edits;
+    // Bumped whenever `edits` starts over, after which every slot counts as edited
+    uint32_t generation = 0;
+
+    // Which parts of the grid are all blocks and which changed, kept up to date with the runs
+    GridTiles tiles;
+    // Standard crossword numbering, per cell: every cell that starts a run gets the next
+    // number in reading order, the rest get 0
+    Vec<int> numbers;
+
+private:
+    [[nodiscard]] int index(bool across, int line, int i) const {
+        return across ? line * size.x + i : i * size.x + line;
+    }
+
+    // Frees the runs of `line` next to or through `i` and rescans the open cells around it.
+    void relink(const char *letters, bool across, int line, int i) {
+        Vec<int> &slot_at = across ? across_at : down_at;
+        int line_len = across ? size.x : size.y;
+
+        int first = i;
+        while (first > 0 && letters[index(across, line, first - 1)] != '\0') {
+            first -= 1;
+        }
+        int last = i;
+        while (last < line_len - 1 && letters[index(across, line, last + 1)] != '\0') {
+            last += 1;
+        }
+
+        for (int j = math::max(i - 1, 0); j <= math::min(i + 1, line_len - 1); ++j) {
+            int slot = slot_at[index(across, line, j)];
+            if (slot != -1) {
+                release(slot);
+            }
+        }
+        scan(letters, across, line, first, last);
+    }
+
+    // Adds the runs that lie within cells first..last of `line`.
+    void scan(const char *letters, bool across, int line, int first, int last) {
+        int run = 0;
+        for (int i = first; i <= last + 1; ++i) {
+            if (i <= last && letters[index(across, line, i)] != '\0') {
+                run += 1;
+                continue;
+            }
+            if (run >= SLOT_MIN_LEN) {
+                Slot slot;
+                slot.across = across;
+                slot.len = run;
+                slot.start = across ? Vector2i(i - run, line) : Vector2i(line, i - run);
+                add(slot);
+            }
+            run = 0;
+        }
+    }
+
+    void add(const Slot &slot) {
+        int id;
+        if (free_slots.size() > 0) {
+            id = free_slots.back();
+            free_slots.pop_back();
+            slots[id] = slot;
+        } else {
+            id = (int) slots.size();
+            slots.push_back(slot);
+        }
+        Vec<int> &slot_at = slot.across ? across_at : down_at;
+        for (int p = 0; p < slot.len; ++p) {
+            slot_at[cell(id, p)] = id;
+        }
+        log_edit(id);
+    }
+
+    void log_edit(int id) {
+        if (edits.size() >= SLOT_TABLE_MAX_EDITS) {
+            generation += 1;
+            edits.clear();
+        }
+        edits.push_back(id);
+    }
+
+    void release(int id) {
+        Vec<int> &slot_at = slots[id].across ? across_at : down_at;
+        for (int p = 0; p < slots[id].len; ++p) {
+            slot_at[cell(id, p)] = -1;
+        }
+        slots[id].len = 0;
+        free_slots.push_back(id);
+    }
+
+    Vec<int> free_slots;
+    Vec<int> across_at;
+    Vec<int> down_at;
+    // The cells update() may have renumbered since the last renumber()
+    int number_from = INT32_MAX;
+    int number_to = -1;
+    // Which runs started on each cell as of the last renumber(), 1 for across and 2 for down
+    Vec<uint8_t> starts;
+};
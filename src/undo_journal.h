@@ -0,0 +1,282 @@
+#pragma once
+
+#include "Jovial/JovialEngine.h"
+#include "Jovial/Std/Vector2i.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "./shareword_parser.h"
+
+using namespace jovial;
+
+// Bytes of history kept, a power of two. A cell edit takes 9, so this is over 100k edits.
+#define UNDO_JOURNAL_BYTES (1 << 20)
+
+enum class UndoKind : uint8_t {
+    Step,  // where an undo step starts
+    Cell,  // a square changed from `before` to `after`
+    Hint,  // one character of a hint changed
+    Number,// a clue was renumbered
+    Insert,// a clue was inserted at `index`, moving the ones after it up
+    Remove,// the clue at `index` was swapped with the last one and popped
+};
+
+// One edit, as recorded and as handed back to undo and redo.
+struct UndoDelta {
+    UndoKind kind = UndoKind::Step;
+    bool across = false;
+    // The cell for Cell, y * width + x; the clue's place in its list for everything else
+    uint32_t index = 0;
+    uint8_t position = 0;
+    char before = 0;
+    char after = 0;
+    int number_before = 0;
+    int number_after = 0;
+
+    // The whole clue, for Insert and Remove
+    int number = 0;
+    Vector2i coords;
+    char hint[SHAREWORD_MAX_HINT_LEN + 1] = {0};
+};
+
+// Undo history as a ring of small records, one per edit, each starting and ending with its
+// length so the ring can be walked both ways. Edits between two mark()s form a step, which
+// starts with a Step record; when the ring is full the oldest steps are dropped, so memory
+// stays the same however long the session. Undoing walks back over the records of one step
+// only, and the undone records stay in place for redo until the next edit.
+//
+// Nothing here is a snapshot of the grid. Every step is undone from its own records, so a
+// snapshot would never be read, and one of a large grid wouldn't even fit in the ring.
+struct UndoJournal {
+    void record(const UndoDelta &delta) {
+        if (overflowed) return;
+        if (ring.empty()) {
+            ring.resize(UNDO_JOURNAL_BYTES);
+        }
+        redo_end = head;
+        if (!open) {
+            step_start = head;
+            append(UndoDelta());
+            steps += 1;
+            open = true;
+        }
+        append(delta);
+    }
+
+    // Ends the current step; the next edit starts a new one.
+    void mark() {
+        open = false;
+        overflowed = false;
+    }
+
+    // Hands the edits of the newest step to `apply(delta, forward = false)`, newest first.
+    // Returns false if there is nothing to undo.
+    template<typename F>
+    bool undo(F &&apply) {
+        mark();
+        if (steps == 0) return false;
+
+        uint64_t pos = head;
+        UndoDelta delta;
+        while (true) {
+            pos -= byte(pos - 1);
+            decode(pos, &delta);
+            if (delta.kind == UndoKind::Step) break;
+            apply(delta, false);
+        }
+        head = pos;
+        steps -= 1;
+        return true;
+    }
+
+    // Hands the edits of the last undone step to `apply(delta, forward = true)`, in the
+    // order they were made. Returns false if there is nothing to redo.
+    template<typename F>
+    bool redo(F &&apply) {
+        mark();
+        if (head == redo_end) return false;
+
+        uint64_t pos = head + byte(head);
+        UndoDelta delta;
+        while (pos < redo_end) {
+            decode(pos, &delta);
+            if (delta.kind == UndoKind::Step) break;
+            apply(delta, true);
+            pos += byte(pos);
+        }
+        head = pos;
+        steps += 1;
+        return true;
+    }
+
+    [[nodiscard]] bool can_undo() const {
+        return steps > 0;
+    }
+
+    [[nodiscard]] bool can_redo() const {
+        return head != redo_end;
+    }
+
+    void clear() {
+        tail = head = redo_end = 0;
+        steps = 0;
+        open = false;
+    }
+
+private:
+    // Positions only ever grow; a position's byte is at `pos % UNDO_JOURNAL_BYTES`
+    [[nodiscard]] uint8_t byte(uint64_t pos) const {
+        return ring[pos & (UNDO_JOURNAL_BYTES - 1)];
+    }
+
+    void put(uint64_t pos, const uint8_t *bytes, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            ring[(pos + i) & (UNDO_JOURNAL_BYTES - 1)] = bytes[i];
+        }
+    }
+
+    void get(uint64_t pos, void *out, size_t len) const {
+        auto *bytes = (uint8_t *) out;
+        for (size_t i = 0; i < len; ++i) {
+            bytes[i] = byte(pos + i);
+        }
+    }
+
+    void append(const UndoDelta &delta) {
+        uint8_t record[128];
+        size_t len = encode(delta, record);
+        while (head + len - tail > UNDO_JOURNAL_BYTES) {
+            if (!drop_oldest()) {
+                // A single step bigger than the whole journal can't be undone, and neither
+                // can anything before it
+                clear();
+                overflowed = true;
+                return;
+            }
+        }
+        put(head, record, len);
+        head += len;
+        redo_end = head;
+    }
+
+    // Drops the oldest step, unless it is the one being recorded.
+    bool drop_oldest() {
+        if (tail == head || (open && tail == step_start)) return false;
+
+        uint64_t pos = tail + byte(tail);
+        while (pos < head && (UndoKind) byte(pos + 1) != UndoKind::Step) {
+            pos += byte(pos);
+        }
+        tail = pos;
+        steps -= 1;
+        return true;
+    }
+
+    // [len][kind][fields...][len]
+    static size_t encode(const UndoDelta &delta, uint8_t *out) {
+        size_t len = 2;
+        auto write = [&](const void *data, size_t size) {
+            memcpy(out + len, data, size);
+            len += size;
+        };
+        out[1] = (uint8_t) delta.kind;
+        uint8_t across = delta.across ? 1 : 0;
+        switch (delta.kind) {
+            case UndoKind::Step:
+                break;
+            case UndoKind::Cell:
+                write(&delta.index, 4);
+                write(&delta.before, 1);
+                write(&delta.after, 1);
+                break;
+            case UndoKind::Hint:
+                write(&across, 1);
+                write(&delta.index, 4);
+                write(&delta.position, 1);
+                write(&delta.before, 1);
+                write(&delta.after, 1);
+                break;
+            case UndoKind::Number:
+                write(&across, 1);
+                write(&delta.index, 4);
+                write(&delta.number_before, 4);
+                write(&delta.number_after, 4);
+                break;
+            case UndoKind::Insert:
+            case UndoKind::Remove: {
+                // Up to the last character that is set, which can be past a '\0' set_hint()
+                // cut the hint short with, so that undoing the cut brings the rest back
+                uint8_t hint_len = SHAREWORD_MAX_HINT_LEN;
+                while (hint_len > 0 && delta.hint[hint_len - 1] == '\0') {
+                    hint_len -= 1;
+                }
+                write(&across, 1);
+                write(&delta.index, 4);
+                write(&delta.number, 4);
+                write(&delta.coords.x, 4);
+                write(&delta.coords.y, 4);
+                write(&hint_len, 1);
+                write(delta.hint, hint_len);
+            } break;
+        }
+        len += 1;
+        out[0] = (uint8_t) len;
+        out[len - 1] = (uint8_t) len;
+        return len;
+    }
+
+    void decode(uint64_t pos, UndoDelta *delta) const {
+        uint64_t at = pos + 2;
+        auto read = [&](void *data, size_t size) {
+            get(at, data, size);
+            at += size;
+        };
+        delta->kind = (UndoKind) byte(pos + 1);
+        uint8_t across = 0;
+        switch (delta->kind) {
+            case UndoKind::Step:
+                break;
+            case UndoKind::Cell:
+                read(&delta->index, 4);
+                read(&delta->before, 1);
+                read(&delta->after, 1);
+                break;
+            case UndoKind::Hint:
+                read(&across, 1);
+                read(&delta->index, 4);
+                read(&delta->position, 1);
+                read(&delta->before, 1);
+                read(&delta->after, 1);
+                break;
+            case UndoKind::Number:
+                read(&across, 1);
+                read(&delta->index, 4);
+                read(&delta->number_before, 4);
+                read(&delta->number_after, 4);
+                break;
+            case UndoKind::Insert:
+            case UndoKind::Remove: {
+                uint8_t hint_len = 0;
+                read(&across, 1);
+                read(&delta->index, 4);
+                read(&delta->number, 4);
+                read(&delta->coords.x, 4);
+                read(&delta->coords.y, 4);
+                read(&hint_len, 1);
+                read(delta->hint, hint_len);
+                memset(delta->hint + hint_len, 0, sizeof(delta->hint) - hint_len);
+            } break;
+        }
+        delta->across = across != 0;
+    }
+
+    std::vector<uint8_t> ring;// allocated on the first edit
+    uint64_t tail = 0;
+    uint64_t head = 0;
+    uint64_t redo_end = 0;
+    uint64_t step_start = 0;
+    size_t steps = 0;
+    bool open = false;
+    bool overflowed = false;
+};
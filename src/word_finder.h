@@ -6,86 +6,186 @@
 #include "Jovial/Std/Array.h"
 #include "Jovial/Std/Vector2i.h"
 #include <cctype>
+#include <cstdio>
+
+#include "./dictionary.h"
+#include "./match_results.h"
+#include "./pattern.h"
+#include "./search_worker.h"
 
 using namespace jovial;
 
+#define WORD_FINDER_PAGE_SIZE 5
+
 class WordFinder {
 public:
     WordFinder() {
-        dictionary = fs::read_entire_file(fs::Path(JV_RES_DIR JV_SEP "dictionary.txt"));
+        fs::Path words(JV_RES_DIR JV_SEP "dictionary.txt");
+        if (!dictionary.open_compiled(fs::Path(JV_RES_DIR JV_SEP "dictionary.swdict"), words)) {
+            dictionary.open(words);
+        }
     }
 
+    // Hands the pattern to the worker; its matches show up through worker.poll() over the
+    // next frames. Patterns that are still being typed, like an unclosed class, keep the
+    // previous results instead.
     void find_words() {
-        int matches_count = 0;
-        for (size_t i = 0; i < dictionary.length() && matches_count < matches.length;) {
-            while (dictionary[i] == ' ' || dictionary[i] == '\n') {
-                i += 1;
-                if (i >= dictionary.length()) {
-                    return;
-                }
-            }
-
-            StringView potential_word = StringView(dictionary.items, 0, dictionary.size() - 1);
-            potential_word.begin = i;
-
-            potential_word = potential_word.chop_to('\n');
-            i += potential_word.size();
+        SearchRequest request;
+        if (anagram_mode) {
+            request.mode = SearchMode::Anagram;
+            request.anagram = AnagramQuery::parse(word, word_len);
+            pattern_error = nullptr;
+        } else {
+            request.mode = SearchMode::Pattern;
+            pattern_error = compile_pattern(&request);
+            if (pattern_error != nullptr) return;
+        }
+        worker.submit(&dictionary, request);
+        page = 0;
+    }
 
-            if (word[word_len - 1] != '*') {
-                if (potential_word.size() != word_len) {
-                    continue;
+    // Besides letters, '_' and a trailing '*', patterns can hold classes like [aeiou] or
+    // [^s], and crossings like {s#ed}: the letters the crossing entry can have at '#', where
+    // it meets this one; the worker looks those letters up. Returns why the pattern can't be
+    // searched yet, or nullptr.
+    const char *compile_pattern(SearchRequest *request) const {
+        CompiledPattern *pattern = &request->pattern;
+        for (int i = 0; i < word_len; ++i) {
+            char c = word[i];
+            if (c == '[') {
+                int close = find_closing(i, ']');
+                if (close == -1) return "Close the [ to search";
+
+                bool negated = i + 1 < close && word[i + 1] == '^';
+                uint32_t mask = 0;
+                for (int j = i + (negated ? 2 : 1); j < close; ++j) {
+                    mask |= pattern_bit(word[j]);
                 }
+                if (mask == 0) return "Put letters between [ and ]";
+
+                pattern->push_mask(negated ? PATTERN_ANY & ~mask : mask);
+                i = close;
+            } else if (c == '{') {
+                int close = find_closing(i, '}');
+                if (close == -1) return "Close the { to search";
+
+                PatternCrossing crossing;
+                crossing.position = pattern->len;
+                const char *error = compile_crossing(i + 1, close, &crossing);
+                if (error != nullptr) return error;
+
+                request->crossings.push_back(crossing);
+                pattern->push_any();
+                i = close;
+            } else if (c == '_' || c == '*') {
+                pattern->push_any();
+                pattern->open_ended = c == '*' && i == word_len - 1;
             } else {
-                if (potential_word.size() < word_len) {
-                    continue;
-                }
+                pattern->push_literal(c);
             }
+        }
+        return nullptr;
+    }
 
-            bool matched = true;
-            for (size_t j = 0; j < word_len && matched; ++j) {
-                if (word[j] != '_' && word[j] != '*') {
-                    if (word[j] != potential_word[j]) {
-                        matched = false;
-                    }
-                }
-            }
-            if (matched) {
-                printj(potential_word);
-                matches[matches_count] = potential_word;
-                matches_count += 1;
+    int find_closing(int open, char closing) const {
+        for (int i = open + 1; i < word_len; ++i) {
+            if (word[i] == closing) return i;
+        }
+        return -1;
+    }
+
+    // The crossing word[first, end), with its '#' square.
+    const char *compile_crossing(int first, int end, PatternCrossing *crossing) const {
+        crossing->crossing_at = -1;
+        for (int i = first; i < end; ++i) {
+            if (word[i] == '#') {
+                if (crossing->crossing_at != -1) return "Only one # per crossing";
+                crossing->crossing_at = crossing->crossing.len;
+                crossing->crossing.push_any();
+            } else if (word[i] == '_') {
+                crossing->crossing.push_any();
+            } else {
+                crossing->crossing.push_literal(word[i]);
             }
         }
+        if (crossing->crossing_at == -1) return "Mark the crossing square with #";
+        return nullptr;
     }
 
     void find(Font *font, Vector2 pos) {
-        if (word_len < JV_ARRAY_LEN(word) - 1) {
-            for (char c: Input::get_chars_typed()) {
-                if (c == ' ' || c == '?') {
-                    word[word_len] = '_';
-                    word_len++;
-                } else {
-                    word[word_len] = c;
-                    word_len++;
-                }
-                for (int i = 0; i < matches.length; ++i) {
-                    matches[i] = {};
-                }
+        for (char c: Input::get_chars_typed()) {
+            if (word_len >= (int) JV_ARRAY_LEN(word) - 1) break;
+
+            if (c == ' ' || c == '?') {
+                word[word_len] = '_';
+                word_len++;
+            } else {
+                word[word_len] = c;
+                word_len++;
             }
+            word_changed = true;
         }
 
         if (Input::is_typed(Actions::Backspace) && word_len > 0) {
             word_len--;
             word[word_len] = '\0';
-            for (int i = 0; i < matches.length; ++i) {
-                matches[i] = {};
-            }
+            word_changed = true;
+        }
+        if (Input::is_just_pressed(Actions::Tab)) {
+            anagram_mode = !anagram_mode;
+            word_changed = true;
         }
-        if (Input::is_typed(Actions::Enter) && matches[0].items == nullptr) {
+
+        // The index is only built once the finder is first opened
+        dictionary.index_in_background();
+        if (word_changed && dictionary.is_ready()) {
+            word_changed = false;
             find_words();
         }
+        worker.poll(results);
+
+        if (Input::is_typed(Actions::Up) && page > 0) {
+            page--;
+        }
+        if (Input::is_typed(Actions::Down) && (size_t) (page + 1) * WORD_FINDER_PAGE_SIZE < results.total()) {
+            page++;
+        }
+        size_t first = (size_t) page * WORD_FINDER_PAGE_SIZE;
+        size_t shown = math::min((size_t) WORD_FINDER_PAGE_SIZE, results.total() - math::min(first, results.total()));
+        results.rank(first + shown);
+
+        if (!dictionary.is_ready()) {
+            const char *text = "Indexing dictionary...";
+            float width = font->measure(text).x;
+
+            Vector2 position = pos - Vector2(width / 2, font->size / 2);
+            position.y += font->size;
+            font->draw(position, text);
+        } else if (pattern_error != nullptr && word_len > 0) {
+            float width = font->measure(pattern_error).x;
+
+            Vector2 position = pos - Vector2(width / 2, font->size / 2);
+            position.y += font->size;
+            font->draw(position, pattern_error);
+        } else if (word_len > 0) {
+            char text[64];
+            size_t pages = (results.total() + WORD_FINDER_PAGE_SIZE - 1) / WORD_FINDER_PAGE_SIZE;
+            if (worker.searching()) {
+                snprintf(text, sizeof(text), "Searching... %zu matches so far", results.total());
+            } else if (pages > 1) {
+                snprintf(text, sizeof(text), "%zu matches, page %d of %zu", results.total(), page + 1, pages);
+            } else {
+                snprintf(text, sizeof(text), "%zu matches", results.total());
+            }
+            float width = font->measure(text).x;
+
+            Vector2 position = pos - Vector2(width / 2, font->size / 2);
+            position.y += font->size;
+            font->draw(position, text);
+        }
 
         if (word_len == 0) {
-            const char *text = "Type to start finding";
+            const char *text = anagram_mode ? "Type letters to find anagrams" : "Type to start finding";
             float width = font->measure(text).x;
 
             Vector2 position = pos - Vector2(width / 2, font->size / 2);
@@ -97,20 +197,27 @@ public:
             font->draw(position, word);
         }
 
-        for (int i = 0; i < matches.length; ++i) {
-            float width = measure_text(matches[i], font).x;
+        for (size_t i = 0; i < shown; ++i) {
+            StringView view = dictionary.word(results[first + i].id);
+            float width = measure_text(view, font).x;
 
-            StringView view = matches[i];
             Vector2 position = pos - Vector2(width / 2, font->size / 2);
             position.y -= font->size * (float) (i + 1);
             draw_text(position, view, font, {});
         }
     }
 
-    char word[30] = {};
+    char word[64] = {};
     int word_len = 0;
 
-    String dictionary;
+    bool word_changed = true;
+    const char *pattern_error = nullptr;
+    // Tab switches between patterns and letter racks like "retains" or "rtn__*"
+    bool anagram_mode = false;
+
+    Dictionary dictionary;
+    SearchWorker worker;// declared after the dictionary it reads, so it is stopped first
 
-    Array<StringView, 3> matches{};
+    MatchResults results;
+    int page = 0;
 };
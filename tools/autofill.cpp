@@ -0,0 +1,52 @@
+// Fills the open squares of a crossword without opening a window. Blocks are '~' in the
+// file, and any square that isn't a letter, like '.', is open.
+//
+//     autofill <puzzle.shareword> [out.shareword] [words.txt] [threads]
+
+#include <chrono>
+
+#include "../src/parallel_autofill.h"
+#include "../src/crossword.h"
+#include "../src/dictionary.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printj("usage: autofill <puzzle.shareword> [out.shareword] [words.txt] [threads]");
+        return 1;
+    }
+
+    fs::Path input(argv[1]);
+    fs::Path output(argc > 2 ? argv[2] : argv[1]);
+    fs::Path words(argc > 3 ? argv[3] : "dictionary.txt");
+
+    Crossword crossword(input);
+    if (crossword.letters == nullptr) {
+        JV_CORE_ERROR("could not read ", input.str);
+        return 1;
+    }
+
+    Dictionary dictionary;
+    if (!dictionary.open(words)) {
+        return 1;
+    }
+    dictionary.build_index();
+
+    ParallelAutofill autofill(argc > 4 ? atoi(argv[4]) : 0);
+    auto start = std::chrono::steady_clock::now();
+    AutofillStatus status = autofill.fill(dictionary, crossword);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    printj(autofill_status_text(status), " in ", (size_t) ms, " ms: ", autofill.slots().size(), " slots, ",
+           autofill.nodes, " words tried, ", autofill.backjumps, " backjumps, ", autofill.restarts, " restarts");
+    printj(autofill.threads(), " threads, ", autofill.splits, " splits, ", autofill.steals, " steals");
+    if (autofill.failed_slot != -1) {
+        const FillSlot &slot = autofill.slots()[autofill.failed_slot];
+        printj("Nothing fits the ", slot.across ? "across" : "down", " run at ", slot.start);
+    }
+    if (status != AutofillStatus::Filled) {
+        return 1;
+    }
+
+    crossword.save_to(output);
+    return 0;
+}
@@ -0,0 +1,33 @@
+// Compiles a word list into the binary format WordFinder maps without parsing.
+//
+//     compile_dictionary <words.txt> [out.swdict]
+
+#include "../src/dictionary.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printj("usage: compile_dictionary <words.txt> [out.swdict]");
+        return 1;
+    }
+
+    fs::Path source(argv[1]);
+    fs::Path output(argc > 2 ? argv[2] : "dictionary.swdict");
+
+    FileStamp stamp;
+    if (!FileStamp::of(source, &stamp)) {
+        JV_CORE_ERROR("could not read ", source.str);
+        return 1;
+    }
+
+    Dictionary dictionary;
+    if (!dictionary.open(source)) {
+        return 1;
+    }
+    dictionary.build_index();
+
+    if (!dictionary.save_compiled(output, stamp)) {
+        return 1;
+    }
+    printj("Compiled ", (size_t) dictionary.word_count, " words into ", output.str);
+    return 0;
+}
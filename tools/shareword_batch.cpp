@@ -0,0 +1,273 @@
+// Checks, fills, renumbers and re-saves many crosswords at once without opening a window.
+// Every file gets one JSON line in the summary, and the exit code is 1 if any file had an
+// error or couldn't be filled.
+//
+//     shareword_batch [options] <puzzle.shareword>... (or - to read the paths from stdin)
+//
+//     --fill             fill the open squares, like the autofill tool
+//     --renumber         give the clues the standard numbers of their squares
+//     --out <dir>        save every puzzle into <dir>, under its own file name
+//     --words <file>     word list for --fill (dictionary.txt)
+//     --threads <n>      files processed at once (one per core)
+//     --summary <file>   where the JSON lines go (summary.jsonl)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/autofill.h"
+#include "../src/crossword.h"
+#include "../src/dictionary.h"
+
+struct Options {
+    bool fill = false;
+    bool renumber = false;
+    const char *out = nullptr;
+    const char *words = "dictionary.txt";
+    const char *summary = "summary.jsonl";
+    int threads = 0;
+    std::vector<std::string> files;
+};
+
+struct Report {
+    std::string errors;
+    std::string warnings;
+    bool failed = false;
+
+    void error(const std::string &text) {
+        errors += (errors.empty() ? "" : ",") + json_string(text);
+        failed = true;
+    }
+
+    void warning(const std::string &text) {
+        warnings += (warnings.empty() ? "" : ",") + json_string(text);
+    }
+
+    static std::string json_string(const std::string &text) {
+        std::string out = "\"";
+        for (char c: text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if ((unsigned char) c < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+};
+
+static std::string at(Vector2i coord) {
+    return std::to_string(coord.x) + "," + std::to_string(coord.y);
+}
+
+// Checks that every clue sits on the first square of a run in its direction, and numbers
+// them the standard way if asked to. Returns how many runs have no clue.
+static int check_clues(Crossword &crossword, bool across, bool renumber, Report *report) {
+    Vec<Answer> &answers = across ? crossword.across : crossword.down;
+    const char *direction = across ? "across" : "down";
+    const SlotTable &table = crossword.slots;
+
+    std::vector<bool> clued(table.slots.size(), false);
+    for (Answer &answer: answers) {
+        if (!crossword.contains(answer.coords)) {
+            report->error(std::string(direction) + " clue " + std::to_string(answer.number) + " is outside the grid at " + at(answer.coords));
+            continue;
+        }
+        int slot = across ? table.across_slot(answer.coords) : table.down_slot(answer.coords);
+        if (slot == -1 || !(table.slots[slot].start == answer.coords)) {
+            report->error(std::string(direction) + " clue " + std::to_string(answer.number) + " at " + at(answer.coords) + " doesn't start a word");
+            continue;
+        }
+        if (clued[slot]) {
+            report->error(std::string("two ") + direction + " clues at " + at(answer.coords));
+        }
+        clued[slot] = true;
+
+        int number = crossword.number_at(answer.coords);
+        if (renumber) {
+            answer.number = number;
+        } else if (answer.number != number) {
+            report->warning(std::string(direction) + " clue " + std::to_string(answer.number) + " should be " + std::to_string(number));
+        }
+    }
+
+    int unclued = 0;
+    for (size_t s = 0; s < table.slots.size(); ++s) {
+        if (table.slots[s].len > 0 && table.slots[s].across == across && !clued[s]) {
+            unclued += 1;
+        }
+    }
+    return unclued;
+}
+
+static std::string process(const Options &options, const Dictionary &dictionary, Autofill &autofill, const std::string &file, bool *failed) {
+    auto start = std::chrono::steady_clock::now();
+    Report report;
+    std::string line = "{\"file\":" + Report::json_string(file);
+
+    ShareWordParse parse;
+    Crossword crossword(fs::Path(file.c_str()), &parse);
+    if (crossword.letters == nullptr && !parse.ok()) {
+        report.error(std::to_string(parse.line) + ":" + std::to_string(parse.column) + ": " + shareword_error_text(parse.error));
+    } else if (crossword.letters == nullptr) {
+        report.error("could not read the file");
+    } else {
+        int open = 0;
+        int empty = 0;
+        int unchecked = 0;
+        for (int y = 0; y < crossword.size.y; ++y) {
+            for (int x = 0; x < crossword.size.x; ++x) {
+                char c = crossword.at({x, y});
+                if (c == '\0') continue;
+                open += 1;
+                empty += isalpha((unsigned char) c) ? 0 : 1;
+                unchecked += crossword.slots.across_slot({x, y}) == -1 || crossword.slots.down_slot({x, y}) == -1 ? 1 : 0;
+            }
+        }
+        int words = 0;
+        for (const Slot &slot: crossword.slots.slots) {
+            if (slot.len == 0) continue;
+            words += 1;
+            if (slot.len > DICTIONARY_MAX_WORD_LEN) {
+                report.warning("the " + std::string(slot.across ? "across" : "down") + " word at " + at(slot.start) + " is longer than any dictionary word");
+            }
+        }
+
+        int unclued = check_clues(crossword, true, options.renumber, &report) +
+                      check_clues(crossword, false, options.renumber, &report);
+        if (options.renumber) {
+            crossword.sort_answers();
+        }
+
+        char stats[160];
+        snprintf(stats, sizeof(stats), ",\"width\":%d,\"height\":%d,\"words\":%d,\"open\":%d,\"empty\":%d,\"unchecked\":%d,\"unclued\":%d",
+                 crossword.size.x, crossword.size.y, words, open, empty, unchecked, unclued);
+        line += stats;
+
+        if (options.fill && empty > 0) {
+            AutofillStatus status = autofill.fill(dictionary, crossword);
+            line += ",\"fill\":" + Report::json_string(autofill_status_text(status));
+            if (status != AutofillStatus::Filled) {
+                report.failed = true;
+            }
+        }
+
+        if (options.out != nullptr && !report.failed) {
+            size_t slash = file.find_last_of('/');
+            std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+            crossword.save_to(fs::Path((std::string(options.out) + "/" + name).c_str()));
+        }
+    }
+
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    char timing[64];
+    snprintf(timing, sizeof(timing), ",\"ms\":%.2f", ms);
+    line += timing;
+    line += std::string(",\"ok\":") + (report.failed ? "false" : "true");
+    line += ",\"errors\":[" + report.errors + "],\"warnings\":[" + report.warnings + "]}";
+    *failed = report.failed;
+    return line;
+}
+
+static bool parse_options(int argc, char **argv, Options *options) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--fill") == 0) {
+            options->fill = true;
+        } else if (strcmp(arg, "--renumber") == 0) {
+            options->renumber = true;
+        } else if (strcmp(arg, "--out") == 0 && has_value) {
+            options->out = argv[++i];
+        } else if (strcmp(arg, "--words") == 0 && has_value) {
+            options->words = argv[++i];
+        } else if (strcmp(arg, "--summary") == 0 && has_value) {
+            options->summary = argv[++i];
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            options->threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "-") == 0) {
+            std::string path;
+            while (std::getline(std::cin, path)) {
+                if (!path.empty()) {
+                    options->files.push_back(path);
+                }
+            }
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            return false;
+        } else {
+            options->files.emplace_back(arg);
+        }
+    }
+    return !options->files.empty();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        printj("usage: shareword_batch [--fill] [--renumber] [--out <dir>] [--words <file>] [--threads <n>] [--summary <file>] <puzzle.shareword>... | -");
+        return 1;
+    }
+
+    Dictionary dictionary;
+    if (options.fill) {
+        if (!dictionary.open(fs::Path(options.words))) {
+            return 1;
+        }
+        dictionary.build_index();
+    }
+
+    FILE *summary = fopen(options.summary, "w");
+    if (summary == nullptr) {
+        JV_CORE_ERROR("could not write ", options.summary);
+        return 1;
+    }
+
+    int thread_count = options.threads > 0 ? options.threads : (int) std::thread::hardware_concurrency();
+    thread_count = math::max(1, math::min(thread_count, (int) options.files.size()));
+
+    // Workers take the next file until there are none left; the lines are written in file
+    // order once everyone is done
+    std::vector<std::string> lines(options.files.size());
+    std::atomic<size_t> next = 0;
+    std::atomic<int> failed = 0;
+    auto work = [&] {
+        Autofill autofill;
+        for (size_t i = next.fetch_add(1); i < options.files.size(); i = next.fetch_add(1)) {
+            bool file_failed = false;
+            lines[i] = process(options, dictionary, autofill, options.files[i], &file_failed);
+            if (file_failed) {
+                failed.fetch_add(1);
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::string &line: lines) {
+        fprintf(summary, "%s\n", line.c_str());
+    }
+    fclose(summary);
+
+    printj(options.files.size(), " files, ", (size_t) failed.load(), " failed, ", (size_t) ms, " ms on ", thread_count, " threads; summary in ",
+           options.summary);
+    return failed.load() > 0 ? 1 : 0;
+}